@@ -0,0 +1,255 @@
+//
+// Batch mode: many images through a decode -> compute -> encode pipeline
+//
+// Decoding and encoding run on threads of their own, connected to the
+// compute stage by bounded queues. Compute stays on the calling thread, so
+// the executable's own parallelism (OpenMP regions, pthread workers) runs
+// as it does for one image. While image i is computed, image i + 1 is
+// decoded and image i - 1 encoded; the queue bounds keep at most `depth`
+// decoded and `depth` computed images waiting in memory.
+//
+
+#ifndef CSC4005_PROJECT_1_BATCH_HPP
+#define CSC4005_PROJECT_1_BATCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "utils.hpp"
+#include "raw_image.hpp"
+
+/**
+ * Fixed-capacity FIFO between two pipeline stages: push blocks while it is
+ * full, pop while it is empty
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity), closed(false) {
+        pthread_mutex_init(&mutex, nullptr);
+        pthread_cond_init(&not_empty, nullptr);
+        pthread_cond_init(&not_full, nullptr);
+    }
+
+    ~BoundedQueue() {
+        pthread_mutex_destroy(&mutex);
+        pthread_cond_destroy(&not_empty);
+        pthread_cond_destroy(&not_full);
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    void push(const T& item) {
+        pthread_mutex_lock(&mutex);
+        while (items.size() >= capacity)
+            pthread_cond_wait(&not_full, &mutex);
+        items.push_back(item);
+        pthread_cond_signal(&not_empty);
+        pthread_mutex_unlock(&mutex);
+    }
+
+    // false once the queue is closed and drained
+    bool pop(T* item) {
+        pthread_mutex_lock(&mutex);
+        while (items.empty() && !closed)
+            pthread_cond_wait(&not_empty, &mutex);
+        bool got = !items.empty();
+        if (got) {
+            *item = items.front();
+            items.pop_front();
+            pthread_cond_signal(&not_full);
+        }
+        pthread_mutex_unlock(&mutex);
+        return got;
+    }
+
+    // No more pushes: pop drains what is left, then returns false
+    void close() {
+        pthread_mutex_lock(&mutex);
+        closed = true;
+        pthread_cond_broadcast(&not_empty);
+        pthread_mutex_unlock(&mutex);
+    }
+
+private:
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+};
+
+inline bool is_batch_image_name(const std::string& name) {
+    const char* extensions[] = {".jpg", ".jpeg", ".JPG", ".JPEG", ".raw"};
+    for (const char* extension : extensions) {
+        size_t length = strlen(extension);
+        if (name.size() > length && name.compare(name.size() - length, length, extension) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Inputs of a batch: the .jpg / .jpeg / .raw files of a directory in name
+ * order, or the paths listed in a manifest file, one per line (blank lines
+ * and lines starting with # are skipped)
+ * @return false if path is neither
+ */
+inline bool list_batch_inputs(const char* path, std::vector<std::string>* inputs) {
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return false;
+    if (S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(path);
+        if (dir == nullptr)
+            return false;
+        for (struct dirent* entry = readdir(dir); entry != nullptr; entry = readdir(dir))
+            if (is_batch_image_name(entry->d_name))
+                inputs->push_back(std::string(path) + "/" + entry->d_name);
+        closedir(dir);
+        std::sort(inputs->begin(), inputs->end());
+        return true;
+    }
+    std::ifstream manifest(path);
+    if (!manifest)
+        return false;
+    std::string line;
+    while (std::getline(manifest, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty() && line[0] != '#') inputs->push_back(line);
+    }
+    return true;
+}
+
+namespace batch_detail {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Item {
+    int index;
+    JPEGMeta image;     // buffer NULL when the input could not be read
+};
+
+struct Stage {
+    const std::vector<std::string>* inputs;
+    const std::vector<std::string>* outputs;
+    const CodecProfile* codec;
+    BoundedQueue<Item>* queue;
+    double busy_ms;
+    int failures;
+};
+
+inline double elapsed_ms(Clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+inline void* decode_stage(void* arg) {
+    Stage* stage = reinterpret_cast<Stage*>(arg);
+    for (size_t i = 0; i < stage->inputs->size(); i++) {
+        auto begin = Clock::now();
+        JPEGMeta image = read_image((*stage->inputs)[i].c_str(), JCS_UNKNOWN, *stage->codec);
+        stage->busy_ms += elapsed_ms(begin);
+        stage->queue->push({static_cast<int>(i), image});
+    }
+    stage->queue->close();
+    return nullptr;
+}
+
+inline void* encode_stage(void* arg) {
+    Stage* stage = reinterpret_cast<Stage*>(arg);
+    Item item;
+    while (stage->queue->pop(&item)) {
+        auto begin = Clock::now();
+        const std::string& output = (*stage->outputs)[item.index];
+        if (write_image(item.image, output.c_str(), *stage->codec)) {
+            std::cerr << "Failed to write " << output << "\n";
+            stage->failures++;
+        }
+        delete[] item.image.buffer;
+        stage->busy_ms += elapsed_ms(begin);
+    }
+    return nullptr;
+}
+
+} // namespace batch_detail
+
+/**
+ * Run every input through compute, writing the results under output_dir
+ * with the input's file name. compute(const JPEGMeta&) returns the output
+ * image in a new[] buffer. Prints the throughput and the share of the wall
+ * time each stage was busy. Inputs of the same file name in different
+ * directories would overwrite each other's output: they are refused before
+ * anything runs.
+ * @return 0 if every image was read and written, -1 otherwise
+ */
+template <typename Compute>
+int run_batch(const std::vector<std::string>& inputs, const std::string& output_dir, int depth,
+              const CodecProfile& codec, Compute compute) {
+    using namespace batch_detail;
+    std::vector<std::string> outputs;
+    std::map<std::string, size_t> first_input;
+    bool duplicates = false;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        size_t slash = inputs[i].find_last_of('/');
+        outputs.push_back(output_dir + "/" + (slash == std::string::npos ? inputs[i] : inputs[i].substr(slash + 1)));
+        auto first = first_input.insert({outputs[i], i});
+        if (!first.second) {
+            std::cerr << "Batch inputs " << inputs[first.first->second] << " and " << inputs[i]
+                      << " would both be written to " << outputs[i] << "\n";
+            duplicates = true;
+        }
+    }
+    if (duplicates) return -1;
+    BoundedQueue<Item> decoded(std::max(depth, 1));
+    BoundedQueue<Item> computed(std::max(depth, 1));
+    Stage decoder{&inputs, &outputs, &codec, &decoded, 0, 0};
+    Stage encoder{&inputs, &outputs, &codec, &computed, 0, 0};
+
+    auto start_time = Clock::now();
+    pthread_t decode_thread, encode_thread;
+    pthread_create(&decode_thread, nullptr, decode_stage, &decoder);
+    pthread_create(&encode_thread, nullptr, encode_stage, &encoder);
+    double compute_ms = 0;
+    int failures = 0;
+    Item item;
+    while (decoded.pop(&item)) {
+        if (item.image.buffer == NULL) {
+            std::cerr << "Failed to read " << inputs[item.index] << "\n";
+            failures++;
+            continue;
+        }
+        auto begin = Clock::now();
+        JPEGMeta output = compute(item.image);
+        compute_ms += elapsed_ms(begin);
+        delete[] item.image.buffer;
+        computed.push({item.index, output});
+    }
+    computed.close();
+    pthread_join(decode_thread, nullptr);
+    pthread_join(encode_thread, nullptr);
+    double total_ms = elapsed_ms(start_time);
+    failures += encoder.failures;
+
+    std::cout << "Batch: " << inputs.size() << " images in " << static_cast<long>(total_ms) << " milliseconds, "
+              << std::fixed << std::setprecision(2) << inputs.size() / total_ms * 1000 << " images/second\n";
+    std::cout << "Stage utilization: decode " << static_cast<int>(100 * decoder.busy_ms / total_ms)
+              << "%, compute " << static_cast<int>(100 * compute_ms / total_ms)
+              << "%, encode " << static_cast<int>(100 * encoder.busy_ms / total_ms) << "%\n";
+    return failures == 0 ? 0 : -1;
+}
+
+#endif // CSC4005_PROJECT_1_BATCH_HPP
@@ -0,0 +1,569 @@
+//
+// Generic NxN image convolution shared by all PartB backends
+//
+// The kernel size and the number of interleaved channels are template
+// parameters, so every (size, channels) pair gets its own fully unrolled
+// instantiation. A pixel row of an interleaved image is treated as one flat
+// array of width * channels bytes: the neighbour (dy, dx) of element i is
+// simply element i + dx * channels of row y + dy, which lets the compiler
+// vectorize the inner loop across pixels and channels alike.
+//
+// Rank-1 filters (weights[y][x] == column[y] * row[x], e.g. the box filter)
+// can also run as a horizontal 1D pass followed by a vertical 1D pass,
+// which costs 2K instead of K * K multiply-adds per output element.
+//
+// Equal weight (box) filters of any odd size run on running sums instead:
+// a sliding column sum per element plus a sliding window along the row,
+// so every output element costs the same regardless of the radius.
+//
+// Every path works on a tile (a row range times a column range) and only
+// writes the tile's output pixels, so disjoint tiles can run concurrently.
+//
+// The inner loops are marked `omp simd`: build with -fopenmp-simd (or
+// -fopenmp) so that they are vectorized at -O2 as well.
+//
+
+#ifndef CSC4005_PROJECT_1_CONVOLUTION_HPP
+#define CSC4005_PROJECT_1_CONVOLUTION_HPP
+
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * Square filter matrix of odd size, weights stored row-major.
+ * For rank-1 filters, column_weights and row_weights hold the factors.
+ * Box filters have every weight equal to 1 / (size * size).
+ */
+struct Filter {
+    int size;
+    std::vector<float> weights;
+    bool box;
+    bool separable;
+    std::vector<float> column_weights;
+    std::vector<float> row_weights;
+};
+
+/**
+ * How the engine evaluates a filter
+ *  Auto      - running sums for box filters, separable passes for other
+ *              rank-1 filters, direct otherwise
+ *  Direct    - full K * K convolution
+ *  Separable - horizontal then vertical 1D pass, rank-1 filters only
+ *  Box       - running sums, box filters only, any odd size
+ */
+enum class FilterMode { Auto, Direct, Separable, Box };
+
+inline bool parse_filter_mode(const std::string& name, FilterMode* mode) {
+    if (name == "auto") *mode = FilterMode::Auto;
+    else if (name == "direct") *mode = FilterMode::Direct;
+    else if (name == "separable") *mode = FilterMode::Separable;
+    else if (name == "box") *mode = FilterMode::Box;
+    else return false;
+    return true;
+}
+
+// Sizes with a compiled instantiation of the convolution engine
+const int SUPPORTED_FILTER_SIZES[] = {3, 5, 7, 9, 11};
+
+inline bool is_supported_filter_size(int size) {
+    for (int supported : SUPPORTED_FILTER_SIZES)
+        if (size == supported) return true;
+    return false;
+}
+
+// Largest box filter: its window sums, up to size * size * 255, must fit
+// in an int (the bound is about 2900), and the filter's size * size
+// weights stay a few MB
+const int MAX_BOX_FILTER_SIZE = 1023;
+
+/**
+ * Box filters of any odd size up to MAX_BOX_FILTER_SIZE can run on running
+ * sums, the other modes need a compiled instantiation
+ */
+inline bool is_supported_filter_size(int size, FilterMode mode) {
+    if (mode == FilterMode::Auto || mode == FilterMode::Box)
+        return size > 0 && size % 2 == 1 && size <= MAX_BOX_FILTER_SIZE;
+    return is_supported_filter_size(size);
+}
+
+/**
+ * Build a filter from row-major weights and detect whether it is rank-1.
+ * The factors are taken from the row and column of the largest weight,
+ * then every weight is checked against their product.
+ */
+inline Filter make_filter(int size, const std::vector<float>& weights) {
+    Filter filter;
+    filter.size = size;
+    filter.weights = weights;
+    filter.box = true;
+    for (int i = 0; i < size * size; i++)
+        if (std::fabs(weights[i] * size * size - 1.0f) > 1e-6f) filter.box = false;
+    filter.separable = false;
+    int pivot = 0;
+    for (int i = 1; i < size * size; i++)
+        if (std::fabs(weights[i]) > std::fabs(weights[pivot])) pivot = i;
+    float pivot_weight = weights[pivot];
+    if (pivot_weight == 0.0f) return filter;
+    int pivot_row = pivot / size;
+    int pivot_col = pivot % size;
+    std::vector<float> column(size), row(size);
+    for (int i = 0; i < size; i++) {
+        column[i] = weights[i * size + pivot_col] / pivot_weight;
+        row[i] = weights[pivot_row * size + i];
+    }
+    for (int y = 0; y < size; y++)
+        for (int x = 0; x < size; x++)
+            if (std::fabs(column[y] * row[x] - weights[y * size + x]) > 1e-6f * std::fabs(pivot_weight))
+                return filter;
+    filter.separable = true;
+    filter.column_weights = column;
+    filter.row_weights = row;
+    return filter;
+}
+
+/**
+ * Equal weight low-pass filter, every coefficient is 1 / (size * size)
+ */
+inline Filter make_box_filter(int size) {
+    Filter filter;
+    filter.size = size;
+    filter.weights.assign(size * size, 1.0f / (size * size));
+    filter.box = true;
+    filter.separable = true;
+    filter.column_weights.assign(size, 1.0f / size);
+    filter.row_weights.assign(size, 1.0f / size);
+    return filter;
+}
+
+/**
+ * Filter of the --filter switch: "box" (make_box_filter) or "gaussian",
+ * binomial weights C(size-1, y) * C(size-1, x) / 4^(size-1). The gaussian
+ * is built from its weights by make_filter, which finds it rank-1 but not a
+ * box, so auto mode runs it as separable passes; it needs a size with a
+ * compiled instantiation.
+ * @return false for an unknown name or a gaussian size not compiled in
+ */
+inline bool make_named_filter(const std::string& name, int size, Filter* filter) {
+    if (name == "box") {
+        *filter = make_box_filter(size);
+        return true;
+    }
+    if (name != "gaussian" || !is_supported_filter_size(size))
+        return false;
+    std::vector<float> binomial(size, 1.0f);
+    for (int i = 1; i < size; i++)
+        binomial[i] = binomial[i - 1] * (size - i) / i;
+    float total = std::ldexp(1.0f, size - 1);
+    std::vector<float> weights(size * size);
+    for (int y = 0; y < size; y++)
+        for (int x = 0; x < size; x++)
+            weights[y * size + x] = binomial[y] * binomial[x] / (total * total);
+    *filter = make_filter(size, weights);
+    return true;
+}
+
+namespace conv_detail {
+
+// Number of flat row elements accumulated at once, sized to stay in L1
+const int CHUNK = 256;
+
+// Width (in flat row elements) of the column strips of the separable path,
+// K float rows of this width stay resident in L2
+const int STRIP = 4096;
+
+// Compile-time unrolled loop: calls f(0), f(1), ..., f(N - 1)
+template <int N>
+struct Unroll {
+    template <typename F>
+    static inline void run(const F& f) {
+        Unroll<N - 1>::run(f);
+        f(N - 1);
+    }
+};
+
+template <>
+struct Unroll<0> {
+    template <typename F>
+    static inline void run(const F&) {}
+};
+
+// Round half up and saturate to the 8-bit range
+inline unsigned char clamp_round(float value) {
+    value += 0.5f;
+    value = value < 0.0f ? 0.0f : value;
+    value = value > 255.0f ? 255.0f : value;
+    return static_cast<unsigned char>(value);
+}
+
+template <int K, int C>
+inline void convolve_chunk(const unsigned char* const* rows, unsigned char* out,
+                           int begin, int len, const float* weights) {
+    const int R = K / 2;
+    float acc[CHUNK];
+    #pragma omp simd
+    for (int i = 0; i < len; i++) acc[i] = 0.0f;
+    Unroll<K>::run([&](int ky) {
+        Unroll<K>::run([&](int kx) {
+            const unsigned char* src = rows[ky] + begin + (kx - R) * C;
+            const float w = weights[ky * K + kx];
+            #pragma omp simd
+            for (int i = 0; i < len; i++) acc[i] += w * src[i];
+        });
+    });
+    #pragma omp simd
+    for (int i = 0; i < len; i++) out[begin + i] = clamp_round(acc[i]);
+}
+
+/**
+ * Horizontal pass of the box filter: slides a window of size column sums
+ * along the row and writes count rounded means. column_sum holds
+ * count + size - 1 pixels (the outputs plus R halo pixels on each side).
+ * Rounding half up: floor((sum + area / 2) / area) with area odd. The
+ * quotient of (sum + area / 2 + 0.5) is never within 1 / (2 * area) of an
+ * integer, far beyond the error of a double reciprocal.
+ */
+inline void box_window_row(const int* column_sum, unsigned char* out, int count, int size, int C) {
+    const int area = size * size;
+    const int half_area = area / 2;
+    const double inv_area = 1.0 / area;
+    for (int c = 0; c < C; c++) {
+        int window = 0;
+        for (int x = 0; x < size; x++) window += column_sum[x * C + c];
+        for (int x = 0; x < count; x++) {
+            if (x > 0) window += column_sum[(x + size - 1) * C + c] - column_sum[(x - 1) * C + c];
+            out[x * C + c] = static_cast<unsigned char>((window + half_area + 0.5) * inv_area);
+        }
+    }
+}
+
+/**
+ * Zero the output pixels of the tile rows [row_begin, row_end) x columns
+ * [col_begin, col_end) that lie within R of the image edge (the same
+ * border rule as the direct path). out holds row row_begin first.
+ */
+inline void clear_borders(unsigned char* out, int width, int height, int row_begin, int row_end,
+                          int col_begin, int col_end, int R, int C) {
+    const int stride = width * C;
+    const int left_end = col_end < R ? col_end : R;
+    const int right_begin = col_begin > width - R ? col_begin : width - R;
+    for (int y = row_begin; y < row_end; y++) {
+        unsigned char* out_row = out + static_cast<size_t>(y - row_begin) * stride;
+        if (y < R || y >= height - R || width <= 2 * R) {
+            std::memset(out_row + col_begin * C, 0, (col_end - col_begin) * C);
+            continue;
+        }
+        if (col_begin < left_end)
+            std::memset(out_row + col_begin * C, 0, (left_end - col_begin) * C);
+        if (right_begin < col_end)
+            std::memset(out_row + right_begin * C, 0, (col_end - right_begin) * C);
+    }
+}
+
+} // namespace conv_detail
+
+/**
+ * Filter pixels [col_begin, col_end) of one output row.
+ * @param rows K pointers to the input rows y - K/2 ... y + K/2
+ * @param out output row (pixel 0 first), the K/2 border pixels on each side
+ *            are set to 0, pixels outside [col_begin, col_end) are untouched
+ * @param width row width in pixels
+ * @param weights K * K filter weights, row-major
+ */
+template <int K, int C>
+void convolve_row_range(const unsigned char* const* rows, unsigned char* out,
+                        int width, int col_begin, int col_end, const float* weights) {
+    const int R = K / 2;
+    const int begin = (col_begin > R ? col_begin : R) * C;
+    const int end = (col_end < width - R ? col_end : width - R) * C;
+    if (end <= begin) {
+        std::memset(out + col_begin * C, 0, (col_end - col_begin) * C);
+        return;
+    }
+    std::memset(out + col_begin * C, 0, begin - col_begin * C);
+    std::memset(out + end, 0, col_end * C - end);
+    int i = begin;
+    // Full chunks have a compile-time trip count and vectorize cleanly
+    for (; i + conv_detail::CHUNK <= end; i += conv_detail::CHUNK)
+        conv_detail::convolve_chunk<K, C>(rows, out, i, conv_detail::CHUNK, weights);
+    if (i < end)
+        conv_detail::convolve_chunk<K, C>(rows, out, i, end - i, weights);
+}
+
+/**
+ * Filter one whole output row, see convolve_row_range
+ */
+template <int K, int C>
+void convolve_row(const unsigned char* const* rows, unsigned char* out,
+                  int width, const float* weights) {
+    convolve_row_range<K, C>(rows, out, width, 0, width, weights);
+}
+
+/**
+ * Filter the tile rows [row_begin, row_end) x columns [col_begin, col_end)
+ * of an image. Rows closer than K/2 to the top or bottom edge are set to 0.
+ * @param out buffer receiving row row_begin first, (row_end - row_begin)
+ *            full-width rows of which only the tile columns are written
+ */
+template <int K, int C>
+void convolve_rows(const unsigned char* in, unsigned char* out, int width, int height,
+                   int row_begin, int row_end, int col_begin, int col_end, const float* weights) {
+    const int R = K / 2;
+    const int stride = width * C;
+    const unsigned char* rows[K];
+    for (int y = row_begin; y < row_end; y++) {
+        unsigned char* out_row = out + static_cast<size_t>(y - row_begin) * stride;
+        if (y < R || y >= height - R) {
+            std::memset(out_row + col_begin * C, 0, (col_end - col_begin) * C);
+            continue;
+        }
+        for (int ky = 0; ky < K; ky++)
+            rows[ky] = in + static_cast<size_t>(y + ky - R) * stride;
+        convolve_row_range<K, C>(rows, out_row, width, col_begin, col_end, weights);
+    }
+}
+
+/**
+ * Separable variant of convolve_rows for rank-1 filters.
+ * The rows are processed in column strips. Within a strip every input row
+ * goes through the horizontal pass exactly once into a ring of K float rows,
+ * and each output row is one vertical pass over the ring.
+ */
+template <int K, int C>
+void separable_rows(const unsigned char* in, unsigned char* out, int width, int height,
+                    int row_begin, int row_end, int col_begin, int col_end,
+                    const float* column_weights, const float* row_weights) {
+    const int R = K / 2;
+    const int stride = width * C;
+    conv_detail::clear_borders(out, width, height, row_begin, row_end, col_begin, col_end, R, C);
+    const int y_begin = row_begin > R ? row_begin : R;
+    const int y_end = row_end < height - R ? row_end : height - R;
+    const int x_begin = (col_begin > R ? col_begin : R) * C;
+    const int x_end = (col_end < width - R ? col_end : width - R) * C;
+    if (y_begin >= y_end || x_begin >= x_end) return;
+
+    std::vector<float> ring(static_cast<size_t>(K) * conv_detail::STRIP);
+    for (int strip = x_begin; strip < x_end; strip += conv_detail::STRIP) {
+        const int len = x_end - strip < conv_detail::STRIP ? x_end - strip : conv_detail::STRIP;
+        for (int y = y_begin - R; y < y_end + R; y++) {
+            // Horizontal pass of input row y into its ring slot
+            float* h = ring.data() + static_cast<size_t>(y % K) * conv_detail::STRIP;
+            const unsigned char* src_row = in + static_cast<size_t>(y) * stride + strip;
+            #pragma omp simd
+            for (int i = 0; i < len; i++) h[i] = 0.0f;
+            conv_detail::Unroll<K>::run([&](int kx) {
+                const unsigned char* src = src_row + (kx - R) * C;
+                const float w = row_weights[kx];
+                #pragma omp simd
+                for (int i = 0; i < len; i++) h[i] += w * src[i];
+            });
+            // Vertical pass once the ring holds rows y - 2R ... y
+            const int out_y = y - R;
+            if (out_y < y_begin) continue;
+            unsigned char* dst = out + static_cast<size_t>(out_y - row_begin) * stride + strip;
+            for (int i0 = 0; i0 < len; i0 += conv_detail::CHUNK) {
+                const int n = len - i0 < conv_detail::CHUNK ? len - i0 : conv_detail::CHUNK;
+                float acc[conv_detail::CHUNK];
+                #pragma omp simd
+                for (int i = 0; i < n; i++) acc[i] = 0.0f;
+                conv_detail::Unroll<K>::run([&](int ky) {
+                    const float* v = ring.data() + static_cast<size_t>((out_y + ky - R) % K) * conv_detail::STRIP + i0;
+                    const float w = column_weights[ky];
+                    #pragma omp simd
+                    for (int i = 0; i < n; i++) acc[i] += w * v[i];
+                });
+                #pragma omp simd
+                for (int i = 0; i < n; i++) dst[i0 + i] = conv_detail::clamp_round(acc[i]);
+            }
+        }
+    }
+}
+
+/**
+ * Box filter of any odd size on the tile rows [row_begin, row_end) x columns
+ * [col_begin, col_end) with running sums.
+ * column_sum[i] holds the sum of the size rows around y for element i and
+ * slides down by one add and one subtract per row; the window along the row
+ * slides the same way (conv_detail::box_window_row). Sums are exact
+ * integers, the mean is rounded half up like the floating point paths.
+ */
+inline void box_rows(const unsigned char* in, unsigned char* out, int width, int height,
+                     int row_begin, int row_end, int col_begin, int col_end,
+                     int size, int num_channels) {
+    const int R = size / 2;
+    const int C = num_channels;
+    const int stride = width * C;
+    conv_detail::clear_borders(out, width, height, row_begin, row_end, col_begin, col_end, R, C);
+    const int y_begin = row_begin > R ? row_begin : R;
+    const int y_end = row_end < height - R ? row_end : height - R;
+    const int x_begin = col_begin > R ? col_begin : R;
+    const int x_end = col_end < width - R ? col_end : width - R;
+    if (y_begin >= y_end || x_begin >= x_end) return;
+
+    // Column sums of the output columns plus R halo columns on each side
+    const int first = (x_begin - R) * C;
+    const int n = (x_end - x_begin + 2 * R) * C;
+    std::vector<int> column_sum(n, 0);
+    for (int y = y_begin - R; y <= y_begin + R; y++) {
+        const unsigned char* src = in + static_cast<size_t>(y) * stride + first;
+        #pragma omp simd
+        for (int i = 0; i < n; i++) column_sum[i] += src[i];
+    }
+    for (int y = y_begin; y < y_end; y++) {
+        if (y > y_begin) {
+            const unsigned char* enter = in + static_cast<size_t>(y + R) * stride + first;
+            const unsigned char* leave = in + static_cast<size_t>(y - R - 1) * stride + first;
+            #pragma omp simd
+            for (int i = 0; i < n; i++) column_sum[i] += enter[i] - leave[i];
+        }
+        unsigned char* out_row = out + static_cast<size_t>(y - row_begin) * stride + x_begin * C;
+        conv_detail::box_window_row(column_sum.data(), out_row, x_end - x_begin, size, C);
+    }
+}
+
+template <int K, int C>
+void filter_rows(const Filter& filter, FilterMode mode, const unsigned char* in, unsigned char* out,
+                 int width, int height, int row_begin, int row_end, int col_begin, int col_end) {
+    if (mode == FilterMode::Separable)
+        separable_rows<K, C>(in, out, width, height, row_begin, row_end, col_begin, col_end,
+                             filter.column_weights.data(), filter.row_weights.data());
+    else
+        convolve_rows<K, C>(in, out, width, height, row_begin, row_end, col_begin, col_end,
+                            filter.weights.data());
+}
+
+#define CONV_DISPATCH_SIZE(C)                                                                                               \
+    switch (filter.size) {                                                                                                  \
+        case 3: filter_rows<3, C>(filter, mode, in, out, width, height, row_begin, row_end, col_begin, col_end); break;   \
+        case 5: filter_rows<5, C>(filter, mode, in, out, width, height, row_begin, row_end, col_begin, col_end); break;   \
+        case 7: filter_rows<7, C>(filter, mode, in, out, width, height, row_begin, row_end, col_begin, col_end); break;   \
+        case 9: filter_rows<9, C>(filter, mode, in, out, width, height, row_begin, row_end, col_begin, col_end); break;   \
+        case 11: filter_rows<11, C>(filter, mode, in, out, width, height, row_begin, row_end, col_begin, col_end); break; \
+        default: break;                                                                                                     \
+    }
+
+/**
+ * Runtime entry point for one tile, rows [row_begin, row_end) x columns
+ * [col_begin, col_end): picks the instantiation matching the filter size
+ * and the channel count (1 for gray or planar data, 3 for interleaved RGB).
+ * Box and separable modes fall back to the direct path for filters that do
+ * not qualify.
+ * @param out buffer receiving row row_begin first, full-width rows of which
+ *            only the tile columns are written
+ */
+inline void convolve_tile(const Filter& filter, int num_channels,
+                          const unsigned char* in, unsigned char* out,
+                          int width, int height, int row_begin, int row_end,
+                          int col_begin, int col_end, FilterMode mode = FilterMode::Auto) {
+    if (mode == FilterMode::Auto)
+        mode = filter.box ? FilterMode::Box : FilterMode::Separable;
+    if (mode == FilterMode::Box && !filter.box)
+        mode = FilterMode::Separable;
+    if (mode == FilterMode::Separable && !filter.separable)
+        mode = FilterMode::Direct;
+    if (mode == FilterMode::Box) {
+        box_rows(in, out, width, height, row_begin, row_end, col_begin, col_end, filter.size, num_channels);
+        return;
+    }
+    if (num_channels == 1) {
+        CONV_DISPATCH_SIZE(1)
+    } else if (num_channels == 3) {
+        CONV_DISPATCH_SIZE(3)
+    }
+}
+
+/**
+ * Runtime entry point for whole rows [row_begin, row_end)
+ * @param out buffer receiving row row_begin first, (row_end - row_begin) rows
+ */
+inline void convolve_rows(const Filter& filter, int num_channels,
+                          const unsigned char* in, unsigned char* out,
+                          int width, int height, int row_begin, int row_end,
+                          FilterMode mode = FilterMode::Auto) {
+    convolve_tile(filter, num_channels, in, out, width, height, row_begin, row_end, 0, width, mode);
+}
+
+#undef CONV_DISPATCH_SIZE
+
+/**
+ * Runtime dispatch of convolve_row on the filter size and channel count
+ */
+inline void convolve_row(const Filter& filter, int num_channels, const unsigned char* const* rows,
+                         unsigned char* out, int width) {
+    const float* weights = filter.weights.data();
+#define CONV_ROW_DISPATCH_SIZE(C)                                           \
+    switch (filter.size) {                                                  \
+        case 3: convolve_row<3, C>(rows, out, width, weights); break;       \
+        case 5: convolve_row<5, C>(rows, out, width, weights); break;       \
+        case 7: convolve_row<7, C>(rows, out, width, weights); break;       \
+        case 9: convolve_row<9, C>(rows, out, width, weights); break;       \
+        case 11: convolve_row<11, C>(rows, out, width, weights); break;     \
+        default: break;                                                     \
+    }
+    if (num_channels == 1) {
+        CONV_ROW_DISPATCH_SIZE(1)
+    } else if (num_channels == 3) {
+        CONV_ROW_DISPATCH_SIZE(3)
+    }
+#undef CONV_ROW_DISPATCH_SIZE
+}
+
+/**
+ * Streaming filter: pulls the input rows one by one with read_row(row) and
+ * pushes every output row with write_row(row) as soon as its K input rows
+ * are in, so only a ring of K + 1 input rows and one output row are held
+ * (O(width * K) memory instead of two full images).
+ * Box filters slide their column sums (the extra ring row is the one that
+ * leaves the window); other filters run the direct path on the ring rows,
+ * the separable mode has no streaming variant and falls back to it.
+ * The output is bit-identical to convolve_rows.
+ */
+template <typename ReadRow, typename WriteRow>
+void stream_rows(const Filter& filter, int num_channels, int width, int height,
+                 FilterMode mode, ReadRow read_row, WriteRow write_row) {
+    if (mode == FilterMode::Auto || (mode == FilterMode::Box && !filter.box))
+        mode = filter.box ? FilterMode::Box : FilterMode::Direct;
+    const int K = filter.size;
+    const int R = K / 2;
+    const int stride = width * num_channels;
+    const int ring_size = K + 1;
+    std::vector<unsigned char> ring(static_cast<size_t>(ring_size) * stride);
+    std::vector<unsigned char> out_row(stride);
+    std::vector<int> column_sum(mode == FilterMode::Box ? stride : 0, 0);
+    std::vector<const unsigned char*> rows(K);
+    auto ring_row = [&](int y) { return ring.data() + static_cast<size_t>(y % ring_size) * stride; };
+
+    for (int y_in = 0; y_in < height + R; y_in++) {
+        if (y_in < height) {
+            read_row(ring_row(y_in));
+            if (mode == FilterMode::Box) {
+                // Column sums of rows y_in - 2R .. y_in, for output row y_in - R
+                const unsigned char* enter = ring_row(y_in);
+                #pragma omp simd
+                for (int i = 0; i < stride; i++) column_sum[i] += enter[i];
+                if (y_in >= K) {
+                    const unsigned char* leave = ring_row(y_in - K);
+                    #pragma omp simd
+                    for (int i = 0; i < stride; i++) column_sum[i] -= leave[i];
+                }
+            }
+        }
+        const int y = y_in - R;
+        if (y < 0) continue;
+        std::memset(out_row.data(), 0, stride);
+        if (y >= R && y < height - R && width > 2 * R) {
+            if (mode == FilterMode::Box) {
+                conv_detail::box_window_row(column_sum.data(), out_row.data() + R * num_channels,
+                                            width - 2 * R, K, num_channels);
+            } else {
+                for (int ky = 0; ky < K; ky++)
+                    rows[ky] = ring_row(y + ky - R);
+                convolve_row(filter, num_channels, rows.data(), out_row.data(), width);
+            }
+        }
+        write_row(out_row.data());
+    }
+}
+
+#endif // CSC4005_PROJECT_1_CONVOLUTION_HPP
@@ -0,0 +1,118 @@
+//
+// Throughput and fidelity of the libjpeg codec profiles
+//
+// For every profile, times decoding the input image and encoding the pixels
+// of a default decode to scratch_jpeg (median of `repeats` runs), and
+// reports the PSNR of its decode against the default decode and the PSNR of
+// the encode / decode round trip against the same reference.
+//
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "utils.hpp"
+#include "options.hpp"
+
+/**
+ * PSNR in dB of b against a over size bytes, infinity if they are equal
+ */
+double psnr(const unsigned char* a, const unsigned char* b, size_t size) {
+    double squared_error = 0;
+    for (size_t i = 0; i < size; i++) {
+        double diff = static_cast<double>(a[i]) - b[i];
+        squared_error += diff * diff;
+    }
+    if (squared_error == 0)
+        return INFINITY;
+    return 10 * std::log10(255.0 * 255.0 * size / squared_error);
+}
+
+double median(std::vector<double> times) {
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+int main(int argc, char** argv) {
+    Options options = parse_options(argc, argv);
+    if (options.positional.size() != 2) {
+        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/scratch/jpeg [--repeats=5] [--quality=N]\n";
+        return -1;
+    }
+    int repeats = options.get_int("repeats", 5);
+    int quality = options.get_int("quality", 0);
+    if (repeats < 1 || quality < 0 || quality > 100) {
+        std::cerr << "--repeats must be positive, --quality from 1 to 100\n";
+        return -1;
+    }
+    const char* input_filepath = options.positional[0];
+    const char* scratch_filepath = options.positional[1];
+    std::cout << "Input file from: " << input_filepath << "\n";
+    JPEGMeta reference = read_from_jpeg(input_filepath);
+    if (reference.buffer == NULL) {
+        std::cerr << "Failed to read input JPEG image\n";
+        return -1;
+    }
+    size_t image_size = static_cast<size_t>(reference.width) * reference.height * reference.num_channels;
+    double megapixels = static_cast<double>(reference.width) * reference.height / 1e6;
+    std::cout << reference.width << "x" << reference.height << ", " << reference.num_channels
+              << " channel(s), median of " << repeats << " runs\n";
+    std::cout << "Profile  Quality  Decode (ms)  MP/s  PSNR (dB)  Encode (ms)  MP/s  Size (KB)  Round trip PSNR (dB)\n";
+
+    const char* profiles[] = {"default", "fast", "compact"};
+    for (const char* name : profiles) {
+        CodecProfile profile;
+        parse_codec_profile(name, quality, &profile);
+
+        std::vector<double> decode_times;
+        double decode_psnr = 0;
+        for (int r = 0; r < repeats; r++) {
+            auto start_time = std::chrono::high_resolution_clock::now();
+            JPEGMeta decoded = read_from_jpeg(input_filepath, JCS_UNKNOWN, profile);
+            auto end_time = std::chrono::high_resolution_clock::now();
+            decode_times.push_back(std::chrono::duration<double, std::milli>(end_time - start_time).count());
+            if (r == 0) decode_psnr = psnr(reference.buffer, decoded.buffer, image_size);
+            delete[] decoded.buffer;
+        }
+
+        std::vector<double> encode_times;
+        for (int r = 0; r < repeats; r++) {
+            auto start_time = std::chrono::high_resolution_clock::now();
+            int status = write_to_jpeg(reference, scratch_filepath, profile);
+            auto end_time = std::chrono::high_resolution_clock::now();
+            if (status) {
+                std::cerr << "Failed to write " << scratch_filepath << "\n";
+                return -1;
+            }
+            encode_times.push_back(std::chrono::duration<double, std::milli>(end_time - start_time).count());
+        }
+        long file_size = 0;
+        FILE* file = fopen(scratch_filepath, "rb");
+        if (file != NULL) {
+            fseek(file, 0, SEEK_END);
+            file_size = ftell(file);
+            fclose(file);
+        }
+        JPEGMeta round_trip = read_from_jpeg(scratch_filepath, JCS_UNKNOWN, profile);
+        double round_trip_psnr = psnr(reference.buffer, round_trip.buffer, image_size);
+        delete[] round_trip.buffer;
+
+        double decode_ms = median(decode_times);
+        double encode_ms = median(encode_times);
+        std::cout << std::left << std::setw(7) << name << std::right << std::setw(9) << profile.quality
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(13) << decode_ms << std::setw(6) << megapixels / decode_ms * 1000
+                  << std::setw(11) << decode_psnr
+                  << std::setw(13) << encode_ms << std::setw(6) << megapixels / encode_ms * 1000
+                  << std::setw(11) << file_size / 1024.0 << std::setw(22) << round_trip_psnr << "\n";
+    }
+    std::remove(scratch_filepath);
+
+    delete[] reference.buffer;
+    return 0;
+}
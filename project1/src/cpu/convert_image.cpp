@@ -0,0 +1,51 @@
+//
+// Convert an image between JPEG and the raw planar container, e.g. decode a
+// JPEG once into a .raw file that repeated benchmark runs then map
+//
+
+#include <iostream>
+#include <chrono>
+
+#include "utils.hpp"
+#include "raw_image.hpp"
+#include "options.hpp"
+
+int main(int argc, char** argv) {
+    // Verify input argument format
+    Options options = parse_options(argc, argv);
+    if (options.positional.size() != 2) {
+        std::cerr << "Invalid argument, should be: ./executable /path/to/input/{jpeg,raw} /path/to/output/{jpeg,raw} [--codec=default] [--quality=N]\n";
+        return -1;
+    }
+    // --codec / --quality: libjpeg decoder and encoder settings
+    CodecProfile codec;
+    if (!parse_codec_profile(options.get("codec", "default"), options.get_int("quality", 0), &codec)) {
+        std::cerr << "Unknown codec profile, should be --codec=default|fast|compact and --quality from 1 to 100\n";
+        return -1;
+    }
+    const char* input_filepath = options.positional[0];
+    const char* output_filepath = options.positional[1];
+    std::cout << "Input file from: " << input_filepath << "\n";
+    auto start_time = std::chrono::high_resolution_clock::now();
+    auto image = read_image(input_filepath, JCS_UNKNOWN, codec);
+    if (image.buffer == NULL) {
+        std::cerr << "Failed to read input image\n";
+        return -1;
+    }
+    auto read_end_time = std::chrono::high_resolution_clock::now();
+    std::cout << "Output file to: " << output_filepath << "\n";
+    if (write_image(image, output_filepath, codec)) {
+        std::cerr << "Failed to write output image\n";
+        delete[] image.buffer;
+        return -1;
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    delete[] image.buffer;
+    std::cout << image.width << "x" << image.height << ", " << image.num_channels << " channel(s)\n";
+    std::cout << "Read Time: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(read_end_time - start_time).count()
+              << " milliseconds, Write Time: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - read_end_time).count()
+              << " milliseconds\n";
+    return 0;
+}
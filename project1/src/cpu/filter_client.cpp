@@ -0,0 +1,141 @@
+//
+// Load generator for filter_daemon
+//
+// `concurrency` client threads each send requests back to back, one
+// connection per request, until `requests` have been sent in total, and the
+// round-trip latencies are reported as percentiles. Every client thread
+// writes its own output file (output path with -<thread> before the
+// extension) so that concurrent requests do not write the same file.
+//
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+#include "options.hpp"
+#include "unix_socket.hpp"
+
+struct Client {
+    const char* socket_path;
+    std::string request;
+    std::atomic<int>* remaining;
+    std::vector<double> latencies;      // milliseconds
+    double server_ms[4];                // decode, compute, encode, total
+    int errors;
+    std::string last_error;
+};
+
+void* run_client(void* arg) {
+    Client* client = reinterpret_cast<Client*>(arg);
+    while (client->remaining->fetch_sub(1) > 0) {
+        auto start_time = std::chrono::steady_clock::now();
+        int fd = connect_unix_socket(client->socket_path);
+        std::string response;
+        bool ok = fd >= 0 && send_line(fd, client->request) && receive_line(fd, &response);
+        if (fd >= 0) close(fd);
+        auto end_time = std::chrono::steady_clock::now();
+        if (!ok || response.compare(0, 3, "ok\t") != 0) {
+            client->errors++;
+            client->last_error = ok ? response : "no response from the daemon";
+            continue;
+        }
+        client->latencies.push_back(std::chrono::duration<double, std::milli>(end_time - start_time).count());
+        std::stringstream fields(response.substr(3));
+        for (double& ms : client->server_ms) {
+            double value = 0;
+            fields >> value;
+            ms += value;
+        }
+    }
+    return nullptr;
+}
+
+std::string client_output_path(const std::string& path, int index) {
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        dot = path.size();
+    return path.substr(0, dot) + "-" + std::to_string(index) + path.substr(dot);
+}
+
+int main(int argc, char** argv) {
+    Options options = parse_options(argc, argv);
+    std::string op = options.get("op", "filter");
+    if (op == "shutdown" && options.positional.size() == 1) {
+        int fd = connect_unix_socket(options.positional[0]);
+        std::string response;
+        bool ok = fd >= 0 && send_line(fd, "shutdown") && receive_line(fd, &response);
+        if (fd >= 0) close(fd);
+        return ok ? 0 : -1;
+    }
+    if (options.positional.size() != 3 || (op != "filter" && op != "gray")) {
+        std::cerr << "Invalid argument, should be: ./executable /path/to/socket /path/to/input/jpeg /path/to/output/jpeg [--op=filter|gray] [--kernel=3] [--requests=100] [--concurrency=4]\n"
+                     "or: ./executable /path/to/socket --op=shutdown\n";
+        return -1;
+    }
+    int kernel_size = options.get_int("kernel", 3);
+    int num_requests = options.get_int("requests", 100);
+    int concurrency = options.get_int("concurrency", 4);
+    if (num_requests < 1 || concurrency < 1) {
+        std::cerr << "--requests and --concurrency must be positive\n";
+        return -1;
+    }
+
+    std::atomic<int> remaining(num_requests);
+    std::vector<Client> clients(concurrency);
+    for (int i = 0; i < concurrency; i++) {
+        clients[i].socket_path = options.positional[0];
+        clients[i].request = op + "\t" + std::to_string(kernel_size) + "\t" + options.positional[1] + "\t" +
+                             client_output_path(options.positional[2], i);
+        clients[i].remaining = &remaining;
+        std::fill(clients[i].server_ms, clients[i].server_ms + 4, 0.0);
+        clients[i].errors = 0;
+    }
+    auto start_time = std::chrono::steady_clock::now();
+    std::vector<pthread_t> threads(concurrency);
+    for (int i = 0; i < concurrency; i++)
+        pthread_create(&threads[i], nullptr, run_client, &clients[i]);
+    for (auto& thread : threads)
+        pthread_join(thread, nullptr);
+    double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+
+    std::vector<double> latencies;
+    double server_ms[4] = {0, 0, 0, 0};
+    int errors = 0;
+    for (const Client& client : clients) {
+        latencies.insert(latencies.end(), client.latencies.begin(), client.latencies.end());
+        for (int s = 0; s < 4; s++)
+            server_ms[s] += client.server_ms[s];
+        errors += client.errors;
+        if (client.errors > 0)
+            std::cerr << "Request failed: " << client.last_error << "\n";
+    }
+    if (latencies.empty()) {
+        std::cerr << "No request succeeded\n";
+        return -1;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    // Nearest-rank percentile
+    auto percentile = [&](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100 * latencies.size()));
+        return latencies[std::max<size_t>(rank, 1) - 1];
+    };
+    size_t done = latencies.size();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Requests: " << done << " ok, " << errors << " failed, concurrency " << concurrency << "\n";
+    std::cout << "Throughput: " << done / wall_ms * 1000 << " requests/second\n";
+    std::cout << "Latency (ms): p50 " << percentile(50) << ", p90 " << percentile(90) << ", p99 "
+              << percentile(99) << ", max " << latencies.back() << "\n";
+    std::cout << "Server time per request (ms): decode " << server_ms[0] / done << ", compute "
+              << server_ms[1] / done << ", encode " << server_ms[2] / done << ", total " << server_ms[3] / done
+              << "\n";
+    return errors == 0 ? 0 : -1;
+}
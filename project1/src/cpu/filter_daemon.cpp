@@ -0,0 +1,179 @@
+//
+// Long-lived image filtering service on a Unix domain socket
+//
+// Process startup, thread creation and buffer allocation are paid once:
+// num_workers threads are started up front and park on a queue of accepted
+// connections. Each worker serves one request at a time start to end
+// (decode, gray or filter, encode) into its own input and output buffers,
+// which only grow, so steady-state requests allocate no image memory.
+// The protocol is described in unix_socket.hpp; filter_client is the load
+// generator.
+//
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "utils.hpp"
+#include "raw_image.hpp"
+#include "options.hpp"
+#include "convolution.hpp"
+#include "gray.hpp"
+#include "batch.hpp"
+#include "unix_socket.hpp"
+
+struct Service {
+    int listen_fd;
+    FilterMode mode;
+    CodecProfile codec;
+    BoundedQueue<int>* connections;
+    std::atomic<long> served;
+    std::atomic<bool> stopping;
+};
+
+struct Worker {
+    Service* service;
+    std::vector<unsigned char> input;
+    std::vector<unsigned char> output;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsed_ms(Clock::time_point begin, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+/**
+ * Serve one request line, returns the response line
+ */
+std::string serve(Worker* worker, const std::string& request) {
+    const Service& service = *worker->service;
+    std::vector<std::string> fields;
+    std::stringstream stream(request);
+    for (std::string field; std::getline(stream, field, '\t');)
+        fields.push_back(field);
+    if (fields.size() != 4 || (fields[0] != "filter" && fields[0] != "gray"))
+        return "error\tmalformed request, should be op<TAB>kernel<TAB>input<TAB>output";
+    bool gray = fields[0] == "gray";
+    int kernel_size = std::atoi(fields[1].c_str());
+    if (!gray && !is_supported_filter_size(kernel_size, service.mode))
+        return "error\tunsupported kernel size " + fields[1];
+
+    auto start_time = Clock::now();
+    JPEGMeta input;
+    if (read_image_into(fields[2].c_str(), &worker->input, &input, service.codec))
+        return "error\tfailed to read " + fields[2];
+    if (gray && input.num_channels != 3)
+        return "error\tgray needs an RGB input";
+    auto decode_end = Clock::now();
+
+    size_t num_pixels = static_cast<size_t>(input.width) * input.height;
+    JPEGMeta output{nullptr, input.width, input.height, input.num_channels, input.color_space};
+    if (gray) {
+        worker->output.resize(num_pixels);
+        output = {worker->output.data(), input.width, input.height, 1, JCS_GRAYSCALE};
+        rgb_to_gray_fixed(input.buffer, output.buffer, num_pixels);
+    } else {
+        worker->output.resize(num_pixels * input.num_channels);
+        output.buffer = worker->output.data();
+        Filter filter = make_box_filter(kernel_size);
+        convolve_rows(filter, input.num_channels, input.buffer, output.buffer,
+                      input.width, input.height, 0, input.height, service.mode);
+    }
+    auto compute_end = Clock::now();
+
+    if (write_image(output, fields[3].c_str(), service.codec))
+        return "error\tfailed to write " + fields[3];
+    auto end_time = Clock::now();
+
+    std::ostringstream response;
+    response << std::fixed << std::setprecision(3) << "ok\t" << elapsed_ms(start_time, decode_end) << "\t"
+             << elapsed_ms(decode_end, compute_end) << "\t" << elapsed_ms(compute_end, end_time) << "\t"
+             << elapsed_ms(start_time, end_time);
+    return response.str();
+}
+
+void* work(void* arg) {
+    Worker* worker = reinterpret_cast<Worker*>(arg);
+    Service* service = worker->service;
+    int fd;
+    while (service->connections->pop(&fd)) {
+        std::string request;
+        if (receive_line(fd, &request)) {
+            if (request == "shutdown") {
+                // Wakes the accept loop up, which then drains the workers
+                service->stopping = true;
+                shutdown(service->listen_fd, SHUT_RDWR);
+                send_line(fd, "ok");
+            } else {
+                send_line(fd, serve(worker, request));
+                service->served++;
+            }
+        }
+        close(fd);
+    }
+    return nullptr;
+}
+
+int main(int argc, char** argv) {
+    Options options = parse_options(argc, argv);
+    if (options.positional.size() != 2) {
+        std::cerr << "Invalid argument, should be: ./executable /path/to/socket num_workers [--mode=auto] [--codec=default] [--quality=N]\n";
+        return -1;
+    }
+    // --codec / --quality: libjpeg decoder and encoder settings
+    CodecProfile codec;
+    if (!parse_codec_profile(options.get("codec", "default"), options.get_int("quality", 0), &codec)) {
+        std::cerr << "Unknown codec profile, should be --codec=default|fast|compact and --quality from 1 to 100\n";
+        return -1;
+    }
+    FilterMode mode = FilterMode::Auto;
+    if (!parse_filter_mode(options.get("mode", "auto"), &mode)) {
+        std::cerr << "Unknown filter mode, should be one of auto, direct, separable, box\n";
+        return -1;
+    }
+    const char* socket_path = options.positional[0];
+    int num_workers = std::stoi(options.positional[1]);
+    if (num_workers < 1) {
+        std::cerr << "num_workers must be positive\n";
+        return -1;
+    }
+    int listen_fd = listen_unix_socket(socket_path, 128);
+    if (listen_fd < 0) {
+        std::cerr << "Failed to listen on " << socket_path << "\n";
+        return -1;
+    }
+
+    // Workers are started once and wait for connections
+    BoundedQueue<int> connections(128);
+    Service service{listen_fd, mode, codec, &connections, {0}, {false}};
+    std::vector<Worker> workers(num_workers);
+    std::vector<pthread_t> threads(num_workers);
+    for (int i = 0; i < num_workers; i++) {
+        workers[i].service = &service;
+        pthread_create(&threads[i], nullptr, work, &workers[i]);
+    }
+    std::cout << "Listening on " << socket_path << ", " << num_workers << " workers" << std::endl;
+
+    while (!service.stopping) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        connections.push(fd);
+    }
+    connections.close();
+    for (auto& thread : threads)
+        pthread_join(thread, nullptr);
+    close(listen_fd);
+    unlink(socket_path);
+    std::cout << "Served " << service.served << " requests" << std::endl;
+    return 0;
+}
@@ -0,0 +1,224 @@
+//
+// Hybrid MPI + OpenMP implementation of image filtering
+//
+// One rank per node (or socket) and num_threads OpenMP threads per rank.
+// The master decodes the image once and scatters row bands with their halo
+// rows to the ranks (as mpi_PartB --scatter does); each rank splits its band
+// among its threads like openmp_PartB, and the bands are gathered back with
+// receives posted before the master computes (as mpi_PartB does). MPI is
+// only called from the main thread, outside parallel regions, so
+// MPI_THREAD_FUNNELED is all that is needed.
+//
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <mpi.h>    // MPI Header
+#include <omp.h>    // OpenMP header
+
+#include "utils.hpp"
+#include "raw_image.hpp"
+#include "options.hpp"
+#include "convolution.hpp"
+#include "mpi_scatter.hpp"
+#include "mpi_gather.hpp"
+#include "phases.hpp"
+#include "perf_counters.hpp"
+
+#define MASTER 0
+
+/**
+ * Filter rows [band_begin, band_end) of `input` (input_rows rows) into out,
+ * num_threads bands of rows in parallel
+ */
+void filter_band(const Filter& filter, FilterMode mode, const unsigned char* input, unsigned char* out,
+                 int width, int input_rows, int num_channels, int band_begin, int band_end, int num_threads) {
+    int num_rows = band_end - band_begin;
+    #pragma omp parallel for schedule(static) num_threads(num_threads)
+    for (int part = 0; part < num_threads; part++) {
+        int row_begin = static_cast<long>(num_rows) * part / num_threads;
+        int row_end = static_cast<long>(num_rows) * (part + 1) / num_threads;
+        ThreadPhaseTimer timer(Phase::Compute);
+        PerfScope counters;
+        convolve_rows(filter, num_channels, input, out + static_cast<size_t>(row_begin) * width * num_channels,
+                      width, input_rows, band_begin + row_begin, band_begin + row_end, mode);
+    }
+}
+
+int main(int argc, char** argv) {
+    // Verify input argument format
+    Options options = parse_options(argc, argv);
+    if (options.positional.size() != 3) {
+        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg num_threads_per_rank [--kernel=3] [--mode=auto] [--filter=box] [--codec=default] [--quality=N] [--phases[=file]] [--counters]\n";
+        return -1;
+    }
+    // --codec / --quality: libjpeg decoder and encoder settings
+    CodecProfile codec;
+    if (!parse_codec_profile(options.get("codec", "default"), options.get_int("quality", 0), &codec)) {
+        std::cerr << "Unknown codec profile, should be --codec=default|fast|compact and --quality from 1 to 100\n";
+        return -1;
+    }
+    int num_threads = std::stoi(options.positional[2]);
+    if (num_threads < 1) {
+        std::cerr << "num_threads_per_rank must be positive\n";
+        return -1;
+    }
+    FilterMode mode = FilterMode::Auto;
+    if (!parse_filter_mode(options.get("mode", "auto"), &mode)) {
+        std::cerr << "Unknown filter mode, should be one of auto, direct, separable, box\n";
+        return -1;
+    }
+    int kernel_size = options.get_int("kernel", 3);
+    if (!is_supported_filter_size(kernel_size, mode)) {
+        std::cerr << "Unsupported kernel size " << kernel_size << ", should be one of 3, 5, 7, 9, 11 (any odd size up to " << MAX_BOX_FILTER_SIZE << " in auto or box mode)\n";
+        return -1;
+    }
+    // --filter: box (equal weights) or gaussian (rank-1, not a box)
+    Filter filter;
+    if (!make_named_filter(options.get("filter", "box"), kernel_size, &filter)) {
+        std::cerr << "Unknown filter, should be --filter=box or --filter=gaussian (kernel size 3, 5, 7, 9 or 11)\n";
+        return -1;
+    }
+    // Start the MPI, only the main thread of every rank communicates
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    if (provided < MPI_THREAD_FUNNELED) {
+        std::cerr << "The MPI library does not support MPI_THREAD_FUNNELED\n";
+        MPI_Finalize();
+        return -1;
+    }
+    // How many processes are running
+    int numtasks;
+    MPI_Comm_size(MPI_COMM_WORLD, &numtasks);
+    // What's my rank?
+    int taskid;
+    MPI_Comm_rank(MPI_COMM_WORLD, &taskid);
+    // --phases[=file]: time read, compute (also per thread), communicate
+    // and write on every rank, written out as JSON by the master
+    if (options.has("phases")) enable_phase_log(taskid, numtasks);
+    // --counters: cycles, instructions, LLC and dTLB misses of the compute
+    // on every thread of every rank
+    if (options.has("counters")) enable_perf_counters(taskid);
+
+    // Only the master reads the JPEG File
+    JPEGMeta input_jpeg{NULL, 0, 0, 0, JCS_UNKNOWN};
+    if (taskid == MASTER) {
+        const char * input_filepath = options.positional[0];
+        std::cout << "Input file from: " << input_filepath << "\n";
+        PhaseTimer read_timer(Phase::Read);
+        input_jpeg = read_image(input_filepath, JCS_UNKNOWN, codec);
+        read_timer.stop();
+        if (input_jpeg.buffer == NULL)
+            std::cerr << "Failed to read input JPEG image\n";
+    }
+    PhaseTimer broadcast_timer(Phase::Communicate);
+    broadcast_jpeg_meta(&input_jpeg, MASTER, MPI_COMM_WORLD);
+    broadcast_timer.stop();
+    if (input_jpeg.width == 0) {
+        MPI_Finalize();
+        return -1;
+    }
+    if (numtasks > 1 && input_jpeg.height / numtasks < kernel_size / 2) {
+        if (taskid == MASTER)
+            std::cerr << "Too many processes, every band needs at least " << kernel_size / 2 << " rows\n";
+        delete[] input_jpeg.buffer;
+        MPI_Finalize();
+        return -1;
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    // Divide the image by whole rows, 4 4 3 rather than 3 3 5 for 11 rows
+    // and 3 ranks
+    int row_num_per_task = input_jpeg.height / numtasks;
+    int left_row_num = input_jpeg.height % numtasks;
+    int row_size = input_jpeg.width * input_jpeg.num_channels;
+    std::vector<int> cuts(numtasks + 1, 0);
+    for (int i = 0; i < numtasks; i++)
+        cuts[i + 1] = cuts[i] + row_num_per_task + (i < left_row_num ? 1 : 0);
+
+    // The rank's band and K/2 halo rows on each side
+    int band_first_row, band_input_rows;
+    PhaseTimer scatter_timer(Phase::Communicate);
+    unsigned char* band_input = scatter_bands(input_jpeg.buffer, cuts, row_size, kernel_size / 2, MASTER,
+                                              MPI_COMM_WORLD, &band_first_row, &band_input_rows);
+    scatter_timer.stop();
+    int band_begin = cuts[taskid] - band_first_row;
+    int band_end = cuts[taskid + 1] - band_first_row;
+
+    int status = 0;
+    if (taskid == MASTER) {
+        // Post the receives of the other ranks' bands, then filter our own
+        auto filteredImage = new unsigned char[input_jpeg.width * input_jpeg.height * input_jpeg.num_channels];
+        std::vector<MPI_Request> receives = post_chunk_receives(filteredImage, cuts, row_size, input_jpeg.height,
+                                                                MASTER, MPI_COMM_WORLD);
+        PhaseTimer compute_timer(Phase::Compute);
+        filter_band(filter, mode, band_input, filteredImage + static_cast<size_t>(cuts[MASTER]) * row_size,
+                    input_jpeg.width, band_input_rows, input_jpeg.num_channels, band_begin, band_end, num_threads);
+        compute_timer.stop();
+        auto compute_end_time = std::chrono::high_resolution_clock::now();
+        PhaseTimer gather_timer(Phase::Communicate);
+        MPI_Waitall(static_cast<int>(receives.size()), receives.data(), MPI_STATUSES_IGNORE);
+        gather_timer.stop();
+
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        auto compute_time = std::chrono::duration_cast<std::chrono::milliseconds>(compute_end_time - start_time);
+        auto gather_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - compute_end_time);
+
+        // Save
+        const char* output_filepath = options.positional[1];
+        std::cout << "Output file to: " << output_filepath << "\n";
+        JPEGMeta output_jpeg{filteredImage, input_jpeg.width, input_jpeg.height,
+                             input_jpeg.num_channels, input_jpeg.color_space};
+        PhaseTimer write_timer(Phase::Write);
+        if (write_image(output_jpeg, output_filepath, codec)) {
+            // No early return: the other ranks still wait in the gathers
+            // of --counters and --phases below
+            std::cerr << "Failed to write output JPEG to file\n";
+            status = -1;
+        }
+        write_timer.stop();
+
+        // Release the memory
+        delete[] input_jpeg.buffer;
+        delete[] filteredImage;
+        if (status == 0) {
+            std::cout << "Transformation Complete!" << std::endl;
+            std::cout << "Ranks: " << numtasks << ", threads per rank: " << num_threads << "\n";
+            std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
+            std::cout << "Master Compute Time: " << compute_time.count() << " milliseconds, Gather Wait Time: "
+                      << gather_time.count() << " milliseconds\n";
+        }
+    } else {
+        // Filter the band with all threads, then send it as one message
+        int length = cuts[taskid + 1] - cuts[taskid];
+        auto filteredImage = new unsigned char[length * row_size];
+        compute_and_send_chunks(filteredImage, length, row_size, length, MASTER, MPI_COMM_WORLD,
+                                [&](int, int) {
+            PhaseTimer compute_timer(Phase::Compute);
+            filter_band(filter, mode, band_input, filteredImage, input_jpeg.width, band_input_rows,
+                        input_jpeg.num_channels, band_begin, band_end, num_threads);
+        });
+
+        // Release the memory
+        delete[] filteredImage;
+        delete[] band_input;
+    }
+
+    // Every rank's counts are printed by the master
+    if (options.has("counters")) {
+        gather_perf_counters(MASTER, MPI_COMM_WORLD);
+        if (taskid == MASTER)
+            print_perf_counters(static_cast<size_t>(input_jpeg.width) * input_jpeg.height);
+    }
+    // Every rank's phases end up in the master's log
+    if (options.has("phases")) {
+        gather_phase_log(MASTER, MPI_COMM_WORLD);
+        if (taskid == MASTER && write_phase_log(options.get("phases", "1"), argv[0]))
+            std::cerr << "Failed to write the phase log\n";
+    }
+
+    MPI_Finalize();
+    return status;
+}
@@ -1,132 +1,206 @@
-//
-// Created by Yang Yufan on 2023/9/16.
-// Email: yufanyang1@link.cuhk.edu.cn
-//
-// MPI implementation of transforming a JPEG image from RGB to gray
-//
-
-#include <iostream>
-#include <vector>
-#include <chrono>
-
-#include <mpi.h>    // MPI Header
-
-#include "utils.hpp"
-
-#define MASTER 0
-#define TAG_GATHER 0
-
-int main(int argc, char** argv) {
-    // Verify input argument format
-    if (argc != 3) {
-        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg\n";
-        return -1;
-    }
-    // Start the MPI
-    MPI_Init(&argc, &argv);
-    // How many processes are running
-    int numtasks;
-    MPI_Comm_size(MPI_COMM_WORLD, &numtasks);
-    // What's my rank?
-    int taskid;
-    MPI_Comm_rank(MPI_COMM_WORLD, &taskid);
-    // Which node am I running on?
-    int len;
-    char hostname[MPI_MAX_PROCESSOR_NAME];
-    MPI_Get_processor_name(hostname, &len);
-    MPI_Status status;
-
-    // Read JPEG File
-    const char * input_filepath = argv[1];
-    std::cout << "Input file from: " << input_filepath << "\n";
-    auto input_jpeg = read_from_jpeg(input_filepath);
-    if (input_jpeg.buffer == NULL) {
-        std::cerr << "Failed to read input JPEG image\n";
-        return -1;
-    }
-
-    auto start_time = std::chrono::high_resolution_clock::now();
-
-    // Divide the task
-    // For example, there are 11 pixels and 3 tasks, 
-    // we try to divide to 4 4 3 instead of 3 3 5
-    int total_pixel_num = input_jpeg.width * input_jpeg.height;
-    int pixel_num_per_task = total_pixel_num / numtasks;
-    int left_pixel_num = total_pixel_num % numtasks;
-
-    std::vector<int> cuts(numtasks + 1, 0);
-    int divided_left_pixel_num = 0;
-
-    for (int i = 0; i < numtasks; i++) {
-        if (divided_left_pixel_num < left_pixel_num) {
-            cuts[i+1] = cuts[i] + pixel_num_per_task + 1;
-            divided_left_pixel_num++;
-        } else cuts[i+1] = cuts[i] + pixel_num_per_task;
-    }
-
-    // The tasks for the master executor
-    // 1. Transform the first division of the RGB contents to the Gray contents
-    // 2. Receive the transformed Gray contents from slave executors
-    // 3. Write the Gray contents to the JPEG File
-    if (taskid == MASTER) {
-        // Transform the first division of RGB Contents to the gray contents
-        auto grayImage = new unsigned char[input_jpeg.width * input_jpeg.height];
-        for (int i = cuts[MASTER]; i < cuts[MASTER + 1]; i++) {
-            unsigned char r = input_jpeg.buffer[i * input_jpeg.num_channels];
-            unsigned char g = input_jpeg.buffer[i * input_jpeg.num_channels + 1];
-            unsigned char b = input_jpeg.buffer[i * input_jpeg.num_channels + 2];
-            grayImage[i] = static_cast<unsigned char>(0.299 * r + 0.587 * g + 0.114 * b);
-        }
-
-        // Receive the transformed Gray contents from each slave executors
-        for (int i = MASTER + 1; i < numtasks; i++) {
-            unsigned char* start_pos = grayImage + cuts[i];
-            int length = cuts[i+1] - cuts[i];
-            MPI_Recv(start_pos, length, MPI_CHAR, i, TAG_GATHER, MPI_COMM_WORLD, &status);
-        }
-
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-        
-
-        // Save the Gray Image
-        const char* output_filepath = argv[2];
-        std::cout << "Output file to: " << output_filepath << "\n";
-        JPEGMeta output_jpeg{grayImage, input_jpeg.width, input_jpeg.height, 1, JCS_GRAYSCALE};
-        if (write_to_jpeg(output_jpeg, output_filepath)) {
-            std::cerr << "Failed to write output JPEG to file\n";
-            MPI_Finalize();
-            return -1;
-        }
-
-        // Release the memory
-        delete[] input_jpeg.buffer;
-        delete[] grayImage;
-        std::cout << "Transformation Complete!" << std::endl;
-        std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
-    } 
-    // The tasks for the slave executor
-    // 1. Transform the RGB contents to the Gray contents
-    // 2. Send the transformed Gray contents back to the master executor
-    else {
-        // Transform the RGB Contents to the gray contents
-        int length = cuts[taskid + 1] - cuts[taskid]; 
-        auto grayImage = new unsigned char[length];
-        for (int i = cuts[taskid]; i < cuts[taskid + 1]; i++) {
-            unsigned char r = input_jpeg.buffer[i * input_jpeg.num_channels];
-            unsigned char g = input_jpeg.buffer[i * input_jpeg.num_channels + 1];
-            unsigned char b = input_jpeg.buffer[i * input_jpeg.num_channels + 2];
-            int j = i-cuts[taskid];
-            grayImage[j] = static_cast<unsigned char>(0.299 * r + 0.587 * g + 0.114 * b);
-        }
-
-        // Send the gray image back to the master
-        MPI_Send(grayImage, length, MPI_CHAR, MASTER, TAG_GATHER, MPI_COMM_WORLD);
-        
-        // Release the memory
-        delete[] grayImage;
-    }
-
-    MPI_Finalize();
-    return 0;
-}
+//
+// Created by Yang Yufan on 2023/9/16.
+// Email: yufanyang1@link.cuhk.edu.cn
+//
+// MPI implementation of transforming a JPEG image from RGB to gray
+//
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+
+#include <mpi.h>    // MPI Header
+
+#include "utils.hpp"
+#include "raw_image.hpp"
+#include "options.hpp"
+#include "gray.hpp"
+#include "mpi_scatter.hpp"
+#include "mpi_gather.hpp"
+
+#define MASTER 0
+
+int main(int argc, char** argv) {
+    // Verify input argument format
+    Options options = parse_options(argc, argv);
+    if (options.positional.size() != 2) {
+        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg [--scatter] [--chunk=64] [--codec=default] [--quality=N] [--phases[=file]] [--counters]\n";
+        return -1;
+    }
+    // --codec / --quality: libjpeg decoder and encoder settings
+    CodecProfile codec;
+    if (!parse_codec_profile(options.get("codec", "default"), options.get_int("quality", 0), &codec)) {
+        std::cerr << "Unknown codec profile, should be --codec=default|fast|compact and --quality from 1 to 100\n";
+        return -1;
+    }
+    // Rows per message of the gather
+    int chunk_rows = options.get_int("chunk", 64);
+    if (chunk_rows < 1) {
+        std::cerr << "--chunk should be a positive number of rows\n";
+        return -1;
+    }
+    // Start the MPI
+    MPI_Init(&argc, &argv);
+    // How many processes are running
+    int numtasks;
+    MPI_Comm_size(MPI_COMM_WORLD, &numtasks);
+    // What's my rank?
+    int taskid;
+    MPI_Comm_rank(MPI_COMM_WORLD, &taskid);
+    // --phases[=file]: time read, compute, communicate and write on every
+    // rank, written out as JSON by the master
+    if (options.has("phases")) enable_phase_log(taskid, numtasks);
+    // --counters: cycles, instructions, LLC and dTLB misses of the compute
+    // on every thread of every rank
+    if (options.has("counters")) enable_perf_counters(taskid);
+    // Which node am I running on?
+    int len;
+    char hostname[MPI_MAX_PROCESSOR_NAME];
+    MPI_Get_processor_name(hostname, &len);
+
+    // Read JPEG File: every rank decodes it, except in scatter mode where
+    // only the master does and sends each rank its share of the pixels
+    bool scatter = options.has("scatter");
+    JPEGMeta input_jpeg{NULL, 0, 0, 0, JCS_UNKNOWN};
+    if (!scatter || taskid == MASTER) {
+        const char * input_filepath = options.positional[0];
+        std::cout << "Input file from: " << input_filepath << "\n";
+        PhaseTimer read_timer(Phase::Read);
+        input_jpeg = read_image(input_filepath, JCS_UNKNOWN, codec);
+        read_timer.stop();
+        if (input_jpeg.buffer == NULL) {
+            std::cerr << "Failed to read input JPEG image\n";
+            if (!scatter) return -1;
+        }
+    }
+    if (scatter) {
+        PhaseTimer broadcast_timer(Phase::Communicate);
+        broadcast_jpeg_meta(&input_jpeg, MASTER, MPI_COMM_WORLD);
+        broadcast_timer.stop();
+        if (input_jpeg.width == 0) {
+            MPI_Finalize();
+            return -1;
+        }
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    // Divide the task
+    // For example, there are 11 pixels and 3 tasks, 
+    // we try to divide to 4 4 3 instead of 3 3 5
+    int total_pixel_num = input_jpeg.width * input_jpeg.height;
+    int pixel_num_per_task = total_pixel_num / numtasks;
+    int left_pixel_num = total_pixel_num % numtasks;
+
+    std::vector<int> cuts(numtasks + 1, 0);
+    int divided_left_pixel_num = 0;
+
+    for (int i = 0; i < numtasks; i++) {
+        if (divided_left_pixel_num < left_pixel_num) {
+            cuts[i+1] = cuts[i] + pixel_num_per_task + 1;
+            divided_left_pixel_num++;
+        } else cuts[i+1] = cuts[i] + pixel_num_per_task;
+    }
+
+    // Pixels this rank converts, starting with pixel cuts[taskid]: the
+    // whole image, or only its share in scatter mode
+    unsigned char* share = input_jpeg.buffer + static_cast<size_t>(cuts[taskid]) * 3;
+    if (scatter) {
+        int first_pixel, num_pixels;
+        PhaseTimer scatter_timer(Phase::Communicate);
+        share = scatter_bands(input_jpeg.buffer, cuts, 3, 0, MASTER, MPI_COMM_WORLD, &first_pixel, &num_pixels);
+    }
+
+    int status = 0;
+    // The tasks for the master executor
+    // 1. Transform the first division of the RGB contents to the Gray contents
+    // 2. Receive the transformed Gray contents from slave executors
+    // 3. Write the Gray contents to the JPEG File
+    // Messages of the gather carry chunk_rows rows worth of gray pixels
+    int chunk_pixels = chunk_rows * input_jpeg.width;
+    if (taskid == MASTER) {
+        // Post the receives of every slave's chunks first, so that they
+        // arrive while the master converts its own division
+        auto grayImage = new unsigned char[input_jpeg.width * input_jpeg.height];
+        std::vector<MPI_Request> receives = post_chunk_receives(grayImage, cuts, 1, chunk_pixels,
+                                                                MASTER, MPI_COMM_WORLD);
+
+        // Transform the first division of RGB Contents to the gray contents
+        PhaseTimer compute_timer(Phase::Compute);
+        PerfScope counters;
+        rgb_to_gray_fixed(share, grayImage + cuts[MASTER], cuts[MASTER + 1] - cuts[MASTER]);
+        counters.stop();
+        compute_timer.stop();
+        auto compute_end_time = std::chrono::high_resolution_clock::now();
+
+        // Wait for the chunks still in flight
+        PhaseTimer gather_timer(Phase::Communicate);
+        MPI_Waitall(static_cast<int>(receives.size()), receives.data(), MPI_STATUSES_IGNORE);
+        gather_timer.stop();
+
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        auto compute_time = std::chrono::duration_cast<std::chrono::milliseconds>(compute_end_time - start_time);
+        auto gather_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - compute_end_time);
+
+
+        // Save the Gray Image
+        const char* output_filepath = options.positional[1];
+        std::cout << "Output file to: " << output_filepath << "\n";
+        JPEGMeta output_jpeg{grayImage, input_jpeg.width, input_jpeg.height, 1, JCS_GRAYSCALE};
+        PhaseTimer write_timer(Phase::Write);
+        if (write_image(output_jpeg, output_filepath, codec)) {
+            // No early return: the other ranks still wait in the gathers
+            // of --counters and --phases below
+            std::cerr << "Failed to write output JPEG to file\n";
+            status = -1;
+        }
+        write_timer.stop();
+
+        // Release the memory
+        delete[] input_jpeg.buffer;
+        delete[] grayImage;
+        if (status == 0) {
+            std::cout << "Transformation Complete!" << std::endl;
+            std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
+            std::cout << "Master Compute Time: " << compute_time.count() << " milliseconds, Gather Wait Time: "
+                      << gather_time.count() << " milliseconds\n";
+        }
+    } 
+    // The tasks for the slave executor
+    // 1. Transform the RGB contents to the Gray contents
+    // 2. Send the transformed Gray contents back to the master executor,
+    //    chunk by chunk as they are converted
+    else {
+        // Transform the RGB Contents to the gray contents
+        int length = cuts[taskid + 1] - cuts[taskid]; 
+        auto grayImage = new unsigned char[length];
+        compute_and_send_chunks(grayImage, length, 1, chunk_pixels, MASTER, MPI_COMM_WORLD,
+                                [&](int begin, int end) {
+            PhaseTimer compute_timer(Phase::Compute);
+            PerfScope counters;
+            rgb_to_gray_fixed(share + static_cast<size_t>(begin) * 3, grayImage + begin, end - begin);
+        });
+        
+        // Release the memory
+        delete[] grayImage;
+        if (scatter) delete[] share;
+        else delete[] input_jpeg.buffer;
+    }
+
+    // Every rank's counts are printed by the master
+    if (options.has("counters")) {
+        gather_perf_counters(MASTER, MPI_COMM_WORLD);
+        if (taskid == MASTER)
+            print_perf_counters(static_cast<size_t>(input_jpeg.width) * input_jpeg.height);
+    }
+    // Every rank's phases end up in the master's log
+    if (options.has("phases")) {
+        gather_phase_log(MASTER, MPI_COMM_WORLD);
+        if (taskid == MASTER && write_phase_log(options.get("phases", "1"), argv[0]))
+            std::cerr << "Failed to write the phase log\n";
+    }
+
+    MPI_Finalize();
+    return status;
+}
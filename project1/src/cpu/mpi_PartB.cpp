@@ -1,251 +1,236 @@
-//
-// Created by Yang Yufan on 2023/9/16.
-// Email: yufanyang1@link.cuhk.edu.cn
-//
-// MPI implementation of transforming a JPEG image from RGB to gray
-//
-
-#include <iostream>
-#include <vector>
-#include <chrono>
-#include <cmath>
-#include <mpi.h>    // MPI Header
-
-#include "utils.hpp"
-
-#define MASTER 0
-#define TAG_GATHER 0
-
-const int FILTER_SIZE = 3;
-const double filter[FILTER_SIZE][FILTER_SIZE] = {
-    {1.0 / 9, 1.0 / 9, 1.0 / 9},
-    {1.0 / 9, 1.0 / 9, 1.0 / 9},
-    {1.0 / 9, 1.0 / 9, 1.0 / 9}
-};
-
-int main(int argc, char** argv) {
-    // Verify input argument format
-    if (argc != 3) {
-        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg\n";
-        return -1;
-    }
-    // Start the MPI
-    MPI_Init(&argc, &argv);
-    // How many processes are running
-    int numtasks;
-    MPI_Comm_size(MPI_COMM_WORLD, &numtasks);
-    // What's my rank?
-    int taskid;
-    MPI_Comm_rank(MPI_COMM_WORLD, &taskid);
-    // Which node am I running on?
-    int len;
-    char hostname[MPI_MAX_PROCESSOR_NAME];
-    MPI_Get_processor_name(hostname, &len);
-    MPI_Status status;
-
-    // Read JPEG File
-    const char * input_filepath = argv[1];
-    std::cout << "Input file from: " << input_filepath << "\n";
-    auto input_jpeg = read_from_jpeg(input_filepath);
-    if (input_jpeg.buffer == NULL) {
-        std::cerr << "Failed to read input JPEG image\n";
-        return -1;
-    }
-
-    auto start_time = std::chrono::high_resolution_clock::now();
-
-    // Divide the task
-    // For example, there are 11 pixels and 3 tasks, 
-    // we try to divide to 4 4 3 instead of 3 3 5
-    int total_pixel_num = input_jpeg.width * input_jpeg.height;
-    int pixel_num_per_task = total_pixel_num / numtasks;    
-    int left_pixel_num = total_pixel_num % numtasks;
-
-    std::vector<int> cuts(numtasks + 1, 0);
-    int divided_left_pixel_num = 0;
-
-    for (int i = 0; i < numtasks; i++) {
-        if (divided_left_pixel_num < left_pixel_num) {
-            cuts[i+1] = cuts[i] + pixel_num_per_task + 1;
-            divided_left_pixel_num++;
-        } else cuts[i+1] = cuts[i] + pixel_num_per_task;
-    }
-
-    // The tasks for the master executor
-    // 1. Transform the first division of the RGB contents to the Gray contents
-    // 2. Receive the transformed Gray contents from slave executors
-    // 3. Write the Gray contents to the JPEG File
-    if (taskid == MASTER) {
-        // Transform the first division of RGB Contents to the gray contents
-        auto filteredImage = new unsigned char[input_jpeg.width * input_jpeg.height * input_jpeg.num_channels];
-        for (int i = cuts[MASTER]; i < cuts[MASTER + 1]; i++) {
-            int height = i / input_jpeg.width;
-            int width = i % input_jpeg.width;
-
-            //0 0
-            int channel_value_r1 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels] ;
-            int channel_value_g1 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 1];
-            int channel_value_b1 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 2];
-            //1 0
-            int channel_value_r2 = input_jpeg.buffer[((height) * input_jpeg.width + (width-1)) * input_jpeg.num_channels];
-            int channel_value_g2 = input_jpeg.buffer[((height) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 1];
-            int channel_value_b2 = input_jpeg.buffer[((height) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 2];
-            //2 0
-            int channel_value_r3 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels];
-            int channel_value_g3 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 1];
-            int channel_value_b3 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 2];
-            //0 1
-            int channel_value_r4 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width)) * input_jpeg.num_channels];
-            int channel_value_g4 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width)) * input_jpeg.num_channels + 1];
-            int channel_value_b4 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width)) * input_jpeg.num_channels + 2];
-            //1 1
-            int channel_value_r5 = input_jpeg.buffer[((height) * input_jpeg.width + (width)) * input_jpeg.num_channels];
-            int channel_value_g5 = input_jpeg.buffer[((height) * input_jpeg.width + (width)) * input_jpeg.num_channels + 1];
-            int channel_value_b5 = input_jpeg.buffer[((height) * input_jpeg.width + (width)) * input_jpeg.num_channels + 2];
-            //2 1
-            int channel_value_r6 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width)) * input_jpeg.num_channels];
-            int channel_value_g6 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width)) * input_jpeg.num_channels + 1];
-            int channel_value_b6 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width)) * input_jpeg.num_channels + 2];
-            //0 2
-            int channel_value_r7 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels];
-            int channel_value_g7 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 1];
-            int channel_value_b7 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 2];
-            //1 2
-            int channel_value_r8 = input_jpeg.buffer[((height) * input_jpeg.width + (width+1)) * input_jpeg.num_channels];
-            int channel_value_g8 = input_jpeg.buffer[((height) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 1];
-            int channel_value_b8 = input_jpeg.buffer[((height) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 2];
-            //2 2
-            int channel_value_r9 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels];
-            int channel_value_g9 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 1];
-            int channel_value_b9 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 2];
-
-            int sum_r = channel_value_r1 * filter[0][0]+ channel_value_r2 * filter[1][0]+ channel_value_r3 * filter[2][0]+
-                        channel_value_r4 * filter[0][1]+ channel_value_r5 * filter[1][1]+ channel_value_r6 * filter[2][1]+
-                        channel_value_r7 * filter[0][2]+ channel_value_r8 * filter[1][2]+ channel_value_r9 * filter[2][2];
-            
-            int sum_g = channel_value_g1 * filter[0][0]+ channel_value_g2 * filter[1][0]+ channel_value_g3 * filter[2][0]+
-                        channel_value_g4 * filter[0][1]+ channel_value_g5 * filter[1][1]+ channel_value_g6 * filter[2][1]+
-                        channel_value_g7 * filter[0][2]+ channel_value_g8 * filter[1][2]+ channel_value_g9 * filter[2][2];
-
-            int sum_b = channel_value_b1 * filter[0][0]+ channel_value_b2 * filter[1][0]+ channel_value_b3 * filter[2][0]+
-                        channel_value_b4 * filter[0][1]+ channel_value_b5 * filter[1][1]+ channel_value_b6 * filter[2][1]+
-                        channel_value_b7 * filter[0][2]+ channel_value_b8 * filter[1][2]+ channel_value_b9 * filter[2][2];
-                        
-            filteredImage[i * input_jpeg.num_channels] 
-                = static_cast<unsigned char>(std::round(sum_r));
-            filteredImage[i * input_jpeg.num_channels + 1]
-                = static_cast<unsigned char>(std::round(sum_g));
-            filteredImage[i * input_jpeg.num_channels + 2]
-                = static_cast<unsigned char>(std::round(sum_b));
-
-        }
-
-        // Receive the transformed contents from each slave executors
-        for (int i = MASTER + 1; i < numtasks; i++) {
-            unsigned char* start_pos = filteredImage + (cuts[i] * input_jpeg.num_channels);
-            int length = cuts[i+1] - cuts[i];
-            MPI_Recv(start_pos, length * input_jpeg.num_channels, MPI_CHAR, i, TAG_GATHER, MPI_COMM_WORLD, &status);
-        }
-
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-        
-
-        // Save
-        const char* output_filepath = argv[2];
-        std::cout << "Output file to: " << output_filepath << "\n";
-        JPEGMeta output_jpeg{filteredImage, input_jpeg.width, input_jpeg.height,
-                             input_jpeg.num_channels, input_jpeg.color_space};
-        if (write_to_jpeg(output_jpeg, output_filepath)) {
-            std::cerr << "Failed to write output JPEG to file\n";
-            MPI_Finalize();
-            return -1;
-        }
-
-        // Release the memory
-        delete[] input_jpeg.buffer;
-        delete[] filteredImage;
-        std::cout << "Transformation Complete!" << std::endl;
-        std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
-    } 
-    // The tasks for the slave executor
-    // 1. Transform the RGB contents to the Gray contents
-    // 2. Send the transformed Gray contents back to the master executor
-    else {
-        int length = cuts[taskid + 1] - cuts[taskid]; 
-        auto filteredImage = new unsigned char[length * input_jpeg.num_channels];
-        for (int i = cuts[taskid]; i < cuts[taskid + 1]; i++) {
-
-            int height = i / input_jpeg.width;
-            int width = i % input_jpeg.width;
-
-            //0 0
-            int channel_value_r1 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels];
-            int channel_value_g1 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 1];
-            int channel_value_b1 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 2];
-            //1 0
-            int channel_value_r2 = input_jpeg.buffer[((height) * input_jpeg.width + (width-1)) * input_jpeg.num_channels];
-            int channel_value_g2 = input_jpeg.buffer[((height) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 1];
-            int channel_value_b2 = input_jpeg.buffer[((height) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 2];
-            //2 0
-            int channel_value_r3 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels];
-            int channel_value_g3 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 1];
-            int channel_value_b3 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 2];
-            //0 1
-            int channel_value_r4 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width)) * input_jpeg.num_channels];
-            int channel_value_g4 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width)) * input_jpeg.num_channels + 1];
-            int channel_value_b4 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width)) * input_jpeg.num_channels + 2];
-            //1 1
-            int channel_value_r5 = input_jpeg.buffer[((height) * input_jpeg.width + (width)) * input_jpeg.num_channels];
-            int channel_value_g5 = input_jpeg.buffer[((height) * input_jpeg.width + (width)) * input_jpeg.num_channels + 1];
-            int channel_value_b5 = input_jpeg.buffer[((height) * input_jpeg.width + (width)) * input_jpeg.num_channels + 2];
-            //2 1
-            int channel_value_r6 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width)) * input_jpeg.num_channels];
-            int channel_value_g6 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width)) * input_jpeg.num_channels + 1];
-            int channel_value_b6 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width)) * input_jpeg.num_channels + 2];
-            //0 2
-            int channel_value_r7 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels];
-            int channel_value_g7 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 1];
-            int channel_value_b7 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 2];
-            //1 2
-            int channel_value_r8 = input_jpeg.buffer[((height) * input_jpeg.width + (width+1)) * input_jpeg.num_channels];
-            int channel_value_g8 = input_jpeg.buffer[((height) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 1];
-            int channel_value_b8 = input_jpeg.buffer[((height) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 2];
-            //2 2
-            int channel_value_r9 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels];
-            int channel_value_g9 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 1];
-            int channel_value_b9 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 2];
-
-            int sum_r = channel_value_r1 * filter[0][0]+ channel_value_r2 * filter[1][0]+ channel_value_r3 * filter[2][0]+
-                        channel_value_r4 * filter[0][1]+ channel_value_r5 * filter[1][1]+ channel_value_r6 * filter[2][1]+
-                        channel_value_r7 * filter[0][2]+ channel_value_r8 * filter[1][2]+ channel_value_r9 * filter[2][2];
-            
-            int sum_g = channel_value_g1 * filter[0][0]+ channel_value_g2 * filter[1][0]+ channel_value_g3 * filter[2][0]+
-                        channel_value_g4 * filter[0][1]+ channel_value_g5 * filter[1][1]+ channel_value_g6 * filter[2][1]+
-                        channel_value_g7 * filter[0][2]+ channel_value_g8 * filter[1][2]+ channel_value_g9 * filter[2][2];
-
-            int sum_b = channel_value_b1 * filter[0][0]+ channel_value_b2 * filter[1][0]+ channel_value_b3 * filter[2][0]+
-                        channel_value_b4 * filter[0][1]+ channel_value_b5 * filter[1][1]+ channel_value_b6 * filter[2][1]+
-                        channel_value_b7 * filter[0][2]+ channel_value_b8 * filter[1][2]+ channel_value_b9 * filter[2][2];
-
-            int j = i-cuts[taskid];
-
-            filteredImage[j * input_jpeg.num_channels] =
-                static_cast<unsigned char>(std::round(sum_r));
-            filteredImage[j * input_jpeg.num_channels + 1] =
-                static_cast<unsigned char>(std::round(sum_g));
-            filteredImage[j * input_jpeg.num_channels + 2] =
-                static_cast<unsigned char>(std::round(sum_b));
-
-        }
-
-        // Send the gray image back to the master
-        MPI_Send(filteredImage, length * input_jpeg.num_channels, MPI_CHAR, MASTER, TAG_GATHER, MPI_COMM_WORLD);
-        
-        // Release the memory
-        delete[] filteredImage;
-    }
-
-    MPI_Finalize();
-    return 0;
-}
+//
+// Created by Yang Yufan on 2023/9/16.
+// Email: yufanyang1@link.cuhk.edu.cn
+//
+// MPI implementation of transforming a JPEG image from RGB to gray
+//
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <mpi.h>    // MPI Header
+
+#include "utils.hpp"
+#include "raw_image.hpp"
+#include "options.hpp"
+#include "convolution.hpp"
+#include "mpi_scatter.hpp"
+#include "mpi_gather.hpp"
+
+#define MASTER 0
+
+int main(int argc, char** argv) {
+    // Verify input argument format
+    Options options = parse_options(argc, argv);
+    if (options.positional.size() != 2) {
+        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg [--kernel=3] [--mode=auto] [--filter=box] [--scatter] [--chunk=64] [--codec=default] [--quality=N] [--phases[=file]] [--counters]\n";
+        return -1;
+    }
+    // --codec / --quality: libjpeg decoder and encoder settings
+    CodecProfile codec;
+    if (!parse_codec_profile(options.get("codec", "default"), options.get_int("quality", 0), &codec)) {
+        std::cerr << "Unknown codec profile, should be --codec=default|fast|compact and --quality from 1 to 100\n";
+        return -1;
+    }
+    FilterMode mode = FilterMode::Auto;
+    if (!parse_filter_mode(options.get("mode", "auto"), &mode)) {
+        std::cerr << "Unknown filter mode, should be one of auto, direct, separable, box\n";
+        return -1;
+    }
+    int kernel_size = options.get_int("kernel", 3);
+    if (!is_supported_filter_size(kernel_size, mode)) {
+        std::cerr << "Unsupported kernel size " << kernel_size << ", should be one of 3, 5, 7, 9, 11 (any odd size up to " << MAX_BOX_FILTER_SIZE << " in auto or box mode)\n";
+        return -1;
+    }
+    // --filter: box (equal weights) or gaussian (rank-1, not a box)
+    Filter filter;
+    if (!make_named_filter(options.get("filter", "box"), kernel_size, &filter)) {
+        std::cerr << "Unknown filter, should be --filter=box or --filter=gaussian (kernel size 3, 5, 7, 9 or 11)\n";
+        return -1;
+    }
+    // Rows per message of the gather
+    int chunk_rows = options.get_int("chunk", 64);
+    if (chunk_rows < 1) {
+        std::cerr << "--chunk should be a positive number of rows\n";
+        return -1;
+    }
+    // Start the MPI
+    MPI_Init(&argc, &argv);
+    // How many processes are running
+    int numtasks;
+    MPI_Comm_size(MPI_COMM_WORLD, &numtasks);
+    // What's my rank?
+    int taskid;
+    MPI_Comm_rank(MPI_COMM_WORLD, &taskid);
+    // --phases[=file]: time read, compute, communicate and write on every
+    // rank, written out as JSON by the master
+    if (options.has("phases")) enable_phase_log(taskid, numtasks);
+    // --counters: cycles, instructions, LLC and dTLB misses of the compute
+    // on every thread of every rank
+    if (options.has("counters")) enable_perf_counters(taskid);
+    // Which node am I running on?
+    int len;
+    char hostname[MPI_MAX_PROCESSOR_NAME];
+    MPI_Get_processor_name(hostname, &len);
+
+    // Read JPEG File: every rank decodes it, except in scatter mode where
+    // only the master does and sends each rank its band of rows
+    bool scatter = options.has("scatter");
+    JPEGMeta input_jpeg{NULL, 0, 0, 0, JCS_UNKNOWN};
+    if (!scatter || taskid == MASTER) {
+        const char * input_filepath = options.positional[0];
+        std::cout << "Input file from: " << input_filepath << "\n";
+        PhaseTimer read_timer(Phase::Read);
+        input_jpeg = read_image(input_filepath, JCS_UNKNOWN, codec);
+        read_timer.stop();
+        if (input_jpeg.buffer == NULL) {
+            std::cerr << "Failed to read input JPEG image\n";
+            if (!scatter) return -1;
+        }
+    }
+    if (scatter) {
+        PhaseTimer broadcast_timer(Phase::Communicate);
+        broadcast_jpeg_meta(&input_jpeg, MASTER, MPI_COMM_WORLD);
+        broadcast_timer.stop();
+        if (input_jpeg.width == 0) {
+            MPI_Finalize();
+            return -1;
+        }
+        if (numtasks > 1 && input_jpeg.height / numtasks < kernel_size / 2) {
+            if (taskid == MASTER)
+                std::cerr << "Too many processes for --scatter, every band needs at least " << kernel_size / 2 << " rows\n";
+            delete[] input_jpeg.buffer;
+            MPI_Finalize();
+            return -1;
+        }
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    // Divide the task by whole rows, so that every executor can look up
+    // the neighbours of its pixels in the rows above and below
+    // For example, there are 11 rows and 3 tasks, 
+    // we try to divide to 4 4 3 instead of 3 3 5
+    int total_row_num = input_jpeg.height;
+    int row_num_per_task = total_row_num / numtasks;
+    int left_row_num = total_row_num % numtasks;
+    int row_size = input_jpeg.width * input_jpeg.num_channels;
+
+    std::vector<int> cuts(numtasks + 1, 0);
+    int divided_left_row_num = 0;
+
+    for (int i = 0; i < numtasks; i++) {
+        if (divided_left_row_num < left_row_num) {
+            cuts[i+1] = cuts[i] + row_num_per_task + 1;
+            divided_left_row_num++;
+        } else cuts[i+1] = cuts[i] + row_num_per_task;
+    }
+
+    // Rows this rank filters from: the whole image, or in scatter mode its
+    // band and K/2 halo rows on each side. A band of rows is filtered like
+    // a small image, whose borders are the real ones where the band has no
+    // halo, so both inputs give the same result.
+    unsigned char* band_input = input_jpeg.buffer;
+    int band_first_row = 0;
+    int band_input_rows = input_jpeg.height;
+    if (scatter) {
+        PhaseTimer scatter_timer(Phase::Communicate);
+        band_input = scatter_bands(input_jpeg.buffer, cuts, row_size, kernel_size / 2, MASTER, MPI_COMM_WORLD,
+                                   &band_first_row, &band_input_rows);
+    }
+    int band_begin = cuts[taskid] - band_first_row;
+    int band_end = cuts[taskid + 1] - band_first_row;
+
+    int status = 0;
+    // The tasks for the master executor
+    // 1. Transform the first division of the RGB contents to the Gray contents
+    // 2. Receive the transformed Gray contents from slave executors
+    // 3. Write the Gray contents to the JPEG File
+    if (taskid == MASTER) {
+        // Post the receives of every slave's chunks first, so that they
+        // arrive while the master computes its own division
+        auto filteredImage = new unsigned char[input_jpeg.width * input_jpeg.height * input_jpeg.num_channels];
+        std::vector<MPI_Request> receives = post_chunk_receives(filteredImage, cuts, row_size, chunk_rows,
+                                                                MASTER, MPI_COMM_WORLD);
+
+        // Transform the first division of RGB Contents to the gray contents
+        PhaseTimer compute_timer(Phase::Compute);
+        PerfScope counters;
+        convolve_rows(filter, input_jpeg.num_channels, band_input, filteredImage + static_cast<size_t>(cuts[MASTER]) * row_size,
+                      input_jpeg.width, band_input_rows, band_begin, band_end, mode);
+        counters.stop();
+        compute_timer.stop();
+        auto compute_end_time = std::chrono::high_resolution_clock::now();
+
+        // Wait for the chunks still in flight
+        PhaseTimer gather_timer(Phase::Communicate);
+        MPI_Waitall(static_cast<int>(receives.size()), receives.data(), MPI_STATUSES_IGNORE);
+        gather_timer.stop();
+
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        auto compute_time = std::chrono::duration_cast<std::chrono::milliseconds>(compute_end_time - start_time);
+        auto gather_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - compute_end_time);
+
+
+        // Save
+        const char* output_filepath = options.positional[1];
+        std::cout << "Output file to: " << output_filepath << "\n";
+        JPEGMeta output_jpeg{filteredImage, input_jpeg.width, input_jpeg.height,
+                             input_jpeg.num_channels, input_jpeg.color_space};
+        PhaseTimer write_timer(Phase::Write);
+        if (write_image(output_jpeg, output_filepath, codec)) {
+            // No early return: the other ranks still wait in the gathers
+            // of --counters and --phases below
+            std::cerr << "Failed to write output JPEG to file\n";
+            status = -1;
+        }
+        write_timer.stop();
+
+        // Release the memory
+        delete[] input_jpeg.buffer;
+        delete[] filteredImage;
+        if (status == 0) {
+            std::cout << "Transformation Complete!" << std::endl;
+            std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
+            std::cout << "Master Compute Time: " << compute_time.count() << " milliseconds, Gather Wait Time: "
+                      << gather_time.count() << " milliseconds\n";
+        }
+    } 
+    // The tasks for the slave executor
+    // 1. Transform the RGB contents to the Gray contents
+    // 2. Send the transformed Gray contents back to the master executor,
+    //    chunk by chunk as they are computed
+    else {
+        int length = cuts[taskid + 1] - cuts[taskid]; 
+        auto filteredImage = new unsigned char[length * row_size];
+        compute_and_send_chunks(filteredImage, length, row_size, chunk_rows, MASTER, MPI_COMM_WORLD,
+                                [&](int begin, int end) {
+            PhaseTimer compute_timer(Phase::Compute);
+            PerfScope counters;
+            convolve_rows(filter, input_jpeg.num_channels, band_input, filteredImage + static_cast<size_t>(begin) * row_size,
+                          input_jpeg.width, band_input_rows, band_begin + begin, band_begin + end, mode);
+        });
+        
+        // Release the memory
+        delete[] filteredImage;
+        if (scatter) delete[] band_input;
+        else delete[] input_jpeg.buffer;
+    }
+
+    // Every rank's counts are printed by the master
+    if (options.has("counters")) {
+        gather_perf_counters(MASTER, MPI_COMM_WORLD);
+        if (taskid == MASTER)
+            print_perf_counters(static_cast<size_t>(input_jpeg.width) * input_jpeg.height);
+    }
+    // Every rank's phases end up in the master's log
+    if (options.has("phases")) {
+        gather_phase_log(MASTER, MPI_COMM_WORLD);
+        if (taskid == MASTER && write_phase_log(options.get("phases", "1"), argv[0]))
+            std::cerr << "Failed to write the phase log\n";
+    }
+
+    MPI_Finalize();
+    return status;
+}
@@ -1,70 +1,121 @@
-//
-// Created by Zhang Na on 2023/9/15.
-// Email: nazhang@link.cuhk.edu.cn
-//
-// OpenMP implementation of transforming a JPEG image from RGB to gray
-//
-
-#include <iostream>
-#include <chrono>
-#include <omp.h>    // OpenMP header
-#include "utils.hpp"
-
-int main(int argc, char** argv) {
-    // Verify input argument format
-    if (argc != 3) {
-        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg\n";
-        return -1;
-    }
-    // Read input JPEG image
-    const char* input_filepath = argv[1];
-    std::cout << "Input file from: " << input_filepath << "\n";
-    auto input_jpeg = read_from_jpeg(input_filepath);
-    if (input_jpeg.buffer == NULL) {
-        std::cerr << "Failed to read input JPEG image\n";
-        return -1;
-    }
-    
-    // Separate R, G, B channels into three continuous arrays
-    auto rChannel = new unsigned char[input_jpeg.width * input_jpeg.height];
-    auto gChannel = new unsigned char[input_jpeg.width * input_jpeg.height];
-    auto bChannel = new unsigned char[input_jpeg.width * input_jpeg.height];
-    
-    for (int i = 0; i < input_jpeg.width * input_jpeg.height; i++) {
-        rChannel[i] = input_jpeg.buffer[i * input_jpeg.num_channels];
-        gChannel[i] = input_jpeg.buffer[i * input_jpeg.num_channels + 1];
-        bChannel[i] = input_jpeg.buffer[i * input_jpeg.num_channels + 2];
-    }
-
-    // Transforming the R, G, B channels to Gray in parallel
-    auto grayImage = new unsigned char[input_jpeg.width * input_jpeg.height];
-    auto start_time = std::chrono::high_resolution_clock::now();
-
-    #pragma omp parallel for default(none) shared(rChannel, gChannel, bChannel, grayImage, input_jpeg)
-    for (int i = 0; i < input_jpeg.width * input_jpeg.height; i++) {
-        grayImage[i] = static_cast<unsigned char>(0.299 * rChannel[i] + 0.587 * gChannel[i] + 0.114 * bChannel[i]);
-    }
-    
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-
-    // Save output JPEG GrayScale image
-    const char* output_filepath = argv[2];
-    std::cout << "Output file to: " << output_filepath << "\n";
-    JPEGMeta output_jpeg{grayImage, input_jpeg.width, input_jpeg.height, 1, JCS_GRAYSCALE};
-    if (write_to_jpeg(output_jpeg, output_filepath)) {
-        std::cerr << "Failed to save output JPEG image\n";
-        return -1;
-    }
-
-    // Release the allocated memory
-    delete[] input_jpeg.buffer;
-    delete[] rChannel;
-    delete[] gChannel;
-    delete[] bChannel;
-    delete[] grayImage;
-    
-    std::cout << "Transformation Complete!" << std::endl;
-    std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
-    return 0;
-}
+//
+// Created by Zhang Na on 2023/9/15.
+// Email: nazhang@link.cuhk.edu.cn
+//
+// OpenMP implementation of transforming a JPEG image from RGB to gray
+//
+
+#include <iostream>
+#include <chrono>
+#include <omp.h>    // OpenMP header
+#include "utils.hpp"
+#include "raw_image.hpp"
+#include "batch.hpp"
+#include "options.hpp"
+#include "gray.hpp"
+#include "phases.hpp"
+#include "perf_counters.hpp"
+
+int main(int argc, char** argv) {
+    // Verify input argument format
+    Options options = parse_options(argc, argv);
+    if (options.positional.size() != 2) {
+        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg [--codec=default] [--quality=N] [--batch] [--queue=2] [--phases[=file]] [--counters]\n";
+        return -1;
+    }
+    // --codec / --quality: libjpeg decoder and encoder settings
+    CodecProfile codec;
+    if (!parse_codec_profile(options.get("codec", "default"), options.get_int("quality", 0), &codec)) {
+        std::cerr << "Unknown codec profile, should be --codec=default|fast|compact and --quality from 1 to 100\n";
+        return -1;
+    }
+    // --phases[=file]: time read, compute (also per thread) and write,
+    // written out as JSON
+    if (options.has("phases")) enable_phase_log();
+    // --counters: cycles, instructions, LLC and dTLB misses of the timed
+    // section, per thread
+    if (options.has("counters")) enable_perf_counters();
+    // --batch: convert every image of a directory (or manifest) into the
+    // output directory, decoding and encoding overlapped with the compute
+    if (options.has("batch")) {
+        std::vector<std::string> inputs;
+        if (!list_batch_inputs(options.positional[0], &inputs)) {
+            std::cerr << "Cannot list the batch inputs, should be a directory or a manifest file\n";
+            return -1;
+        }
+        return run_batch(inputs, options.positional[1], options.get_int("queue", 2), codec,
+                         [](const JPEGMeta& input) {
+            int num_pixels = input.width * input.height;
+            int num_blocks = (num_pixels + GRAY_BLOCK - 1) / GRAY_BLOCK;
+            auto gray = new unsigned char[num_pixels];
+            #pragma omp parallel for schedule(static)
+            for (int block = 0; block < num_blocks; block++) {
+                int begin = block * GRAY_BLOCK;
+                int count = num_pixels - begin < GRAY_BLOCK ? num_pixels - begin : GRAY_BLOCK;
+                rgb_to_gray_fixed(input.buffer + static_cast<size_t>(begin) * 3, gray + begin, count);
+            }
+            return JPEGMeta{gray, input.width, input.height, 1, JCS_GRAYSCALE};
+        });
+    }
+    // Read input JPEG image
+    const char* input_filepath = options.positional[0];
+    std::cout << "Input file from: " << input_filepath << "\n";
+    PhaseTimer read_timer(Phase::Read);
+    auto input_jpeg = read_image(input_filepath, JCS_UNKNOWN, codec);
+    read_timer.stop();
+    if (input_jpeg.buffer == NULL) {
+        std::cerr << "Failed to read input JPEG image\n";
+        return -1;
+    }
+    
+    // Transforming the interleaved RGB pixels to Gray in parallel, one
+    // block of GRAY_BLOCK pixels per iteration
+    int num_pixels = input_jpeg.width * input_jpeg.height;
+    int num_blocks = (num_pixels + GRAY_BLOCK - 1) / GRAY_BLOCK;
+    auto grayImage = new unsigned char[num_pixels];
+    PhaseTimer compute_timer(Phase::Compute);
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    // nowait: a thread's compute time ends with its last block, not at the
+    // barrier closing the region
+    #pragma omp parallel default(none) shared(grayImage, input_jpeg, num_pixels, num_blocks)
+    {
+        ThreadPhaseTimer thread_timer(Phase::Compute);
+        PerfScope counters;
+        #pragma omp for schedule(static) nowait
+        for (int block = 0; block < num_blocks; block++) {
+            int begin = block * GRAY_BLOCK;
+            int count = num_pixels - begin < GRAY_BLOCK ? num_pixels - begin : GRAY_BLOCK;
+            rgb_to_gray_fixed(input_jpeg.buffer + static_cast<size_t>(begin) * 3, grayImage + begin, count);
+        }
+    }
+    
+    auto end_time = std::chrono::high_resolution_clock::now();
+    compute_timer.stop();
+    auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+
+    // Save output JPEG GrayScale image
+    const char* output_filepath = options.positional[1];
+    std::cout << "Output file to: " << output_filepath << "\n";
+    JPEGMeta output_jpeg{grayImage, input_jpeg.width, input_jpeg.height, 1, JCS_GRAYSCALE};
+    PhaseTimer write_timer(Phase::Write);
+    if (write_image(output_jpeg, output_filepath, codec)) {
+        std::cerr << "Failed to save output JPEG image\n";
+        return -1;
+    }
+    write_timer.stop();
+
+    // Release the allocated memory
+    delete[] input_jpeg.buffer;
+    delete[] grayImage;
+    
+    std::cout << "Transformation Complete!" << std::endl;
+    std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
+    if (options.has("counters"))
+        print_perf_counters(static_cast<size_t>(input_jpeg.width) * input_jpeg.height);
+    if (options.has("phases") && write_phase_log(options.get("phases", "1"), argv[0])) {
+        std::cerr << "Failed to write the phase log\n";
+        return -1;
+    }
+    return 0;
+}
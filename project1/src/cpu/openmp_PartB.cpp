@@ -1,143 +1,304 @@
-//
-// Created by Zhang Na on 2023/9/15.
-// Email: nazhang@link.cuhk.edu.cn
-//
-// OpenMP implementation of transforming a JPEG image from RGB to gray
-//
-
-#include <iostream>
-#include <cmath>
-#include <chrono>
-#include <omp.h>    // OpenMP header
-#include "utils.hpp"
-
-const int FILTER_SIZE = 3;
-const double filter[FILTER_SIZE][FILTER_SIZE] = {
-    {1.0 / 9, 1.0 / 9, 1.0 / 9},
-    {1.0 / 9, 1.0 / 9, 1.0 / 9},
-    {1.0 / 9, 1.0 / 9, 1.0 / 9}
-};
-
-
-
-int main(int argc, char** argv) {
-
-    if (argc != 4)
-    {
-        std::cerr << "Invalid argument, should be: ./executable "
-                     "/path/to/input/jpeg /path/to/output/jpeg\n";
-        return -1;
-    }
-
-    int num_threads = std::stoi(argv[3]); // User-specified thread count
-    
-    // Read input JPEG image
-    const char* input_filename = argv[1];
-    std::cout << "Input file from: " << input_filename << "\n";
-    auto input_jpeg = read_from_jpeg(input_filename);
-
-    // Separate R, G, B channels into three continuous arrays
-    auto rChannel = new unsigned char[input_jpeg.width * input_jpeg.height];
-    auto gChannel = new unsigned char[input_jpeg.width * input_jpeg.height];
-    auto bChannel = new unsigned char[input_jpeg.width * input_jpeg.height];
-    
-    for (int i = 0; i < input_jpeg.width * input_jpeg.height; i++) {
-        rChannel[i] = input_jpeg.buffer[i * input_jpeg.num_channels];
-        gChannel[i] = input_jpeg.buffer[i * input_jpeg.num_channels + 1];
-        bChannel[i] = input_jpeg.buffer[i * input_jpeg.num_channels + 2];
-    }
-
-    // Transforming the R, G, B channels
-    auto filteredImage = new unsigned char[input_jpeg.width * input_jpeg.height * input_jpeg.num_channels];
-    for (int i = 0; i < input_jpeg.width * input_jpeg.height * input_jpeg.num_channels; ++i)
-        filteredImage[i] = 0;
-
-    auto start_time = std::chrono::high_resolution_clock::now();
-
-    #pragma omp parallel for default(none) shared(rChannel, gChannel, bChannel, filteredImage, input_jpeg, filter) num_threads(num_threads)
-    for (int height = 1; height < input_jpeg.height - 1; height++)
-    {
-        for (int width = 1; width < input_jpeg.width - 1; width++)
-        {
-            //0 0
-            int channel_value_r1 = rChannel[(height-1) * input_jpeg.width + (width-1)];
-            int channel_value_g1 = gChannel[(height-1) * input_jpeg.width + (width-1)];
-            int channel_value_b1 = bChannel[(height-1) * input_jpeg.width + (width-1)];
-            //1 0
-            int channel_value_r2 = rChannel[(height) * input_jpeg.width + (width-1)];
-            int channel_value_g2 = gChannel[(height) * input_jpeg.width + (width-1)];
-            int channel_value_b2 = bChannel[(height) * input_jpeg.width + (width-1)];
-            //2 0
-            int channel_value_r3 = rChannel[(height+1) * input_jpeg.width + (width-1)];
-            int channel_value_g3 = gChannel[(height+1) * input_jpeg.width + (width-1)];
-            int channel_value_b3 = bChannel[(height+1) * input_jpeg.width + (width-1)];
-            //0 1
-            int channel_value_r4 = rChannel[(height-1) * input_jpeg.width + (width)];
-            int channel_value_g4 = gChannel[(height-1) * input_jpeg.width + (width)];
-            int channel_value_b4 = bChannel[(height-1) * input_jpeg.width + (width)];
-            //1 1
-            int channel_value_r5 = rChannel[(height) * input_jpeg.width + (width)];
-            int channel_value_g5 = gChannel[(height) * input_jpeg.width + (width)];
-            int channel_value_b5 = bChannel[(height) * input_jpeg.width + (width)];
-            //2 1
-            int channel_value_r6 = rChannel[(height+1) * input_jpeg.width + (width)];
-            int channel_value_g6 = gChannel[(height+1) * input_jpeg.width + (width)];
-            int channel_value_b6 = bChannel[(height+1) * input_jpeg.width + (width)];
-            //0 2
-            int channel_value_r7 = rChannel[(height-1) * input_jpeg.width + (width+1)];
-            int channel_value_g7 = gChannel[(height-1) * input_jpeg.width + (width+1)];
-            int channel_value_b7 = bChannel[(height-1) * input_jpeg.width + (width+1)];
-            //1 2
-            int channel_value_r8 = rChannel[(height) * input_jpeg.width + (width+1)];
-            int channel_value_g8 = gChannel[(height) * input_jpeg.width + (width+1)];
-            int channel_value_b8 = bChannel[(height) * input_jpeg.width + (width+1)];
-            //2 2
-            int channel_value_r9 = rChannel[(height+1) * input_jpeg.width + (width+1)];
-            int channel_value_g9 = gChannel[(height+1) * input_jpeg.width + (width+1)];
-            int channel_value_b9 = bChannel[(height+1) * input_jpeg.width + (width+1)];
-
-            int sum_r = channel_value_r1 * filter[0][0]+ channel_value_r2 * filter[1][0]+ channel_value_r3 * filter[2][0]+
-                        channel_value_r4 * filter[0][1]+ channel_value_r5 * filter[1][1]+ channel_value_r6 * filter[2][1]+
-                        channel_value_r7 * filter[0][2]+ channel_value_r8 * filter[1][2]+ channel_value_r9 * filter[2][2];
-            
-            int sum_g = channel_value_g1 * filter[0][0]+ channel_value_g2 * filter[1][0]+ channel_value_g3 * filter[2][0]+
-                        channel_value_g4 * filter[0][1]+ channel_value_g5 * filter[1][1]+ channel_value_g6 * filter[2][1]+
-                        channel_value_g7 * filter[0][2]+ channel_value_g8 * filter[1][2]+ channel_value_g9 * filter[2][2];
-
-            int sum_b = channel_value_b1 * filter[0][0]+ channel_value_b2 * filter[1][0]+ channel_value_b3 * filter[2][0]+
-                        channel_value_b4 * filter[0][1]+ channel_value_b5 * filter[1][1]+ channel_value_b6 * filter[2][1]+
-                        channel_value_b7 * filter[0][2]+ channel_value_b8 * filter[1][2]+ channel_value_b9 * filter[2][2];
-
-            filteredImage[(height * input_jpeg.width + width) * input_jpeg.num_channels]
-                = static_cast<unsigned char>(std::round(sum_r));
-            filteredImage[(height * input_jpeg.width + width) * input_jpeg.num_channels + 1]
-                = static_cast<unsigned char>(std::round(sum_g));
-            filteredImage[(height * input_jpeg.width + width) * input_jpeg.num_channels + 2]
-                = static_cast<unsigned char>(std::round(sum_b));
-        }
-    }
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-
-    // Save output JPEG image
-    const char* output_filepath = argv[2];
-    std::cout << "Output file to: " << output_filepath << "\n";
-    JPEGMeta output_jpeg{filteredImage, input_jpeg.width, input_jpeg.height,
-                         input_jpeg.num_channels, input_jpeg.color_space};
-    if (write_to_jpeg(output_jpeg, output_filepath))
-    {
-        std::cerr << "Failed to write output JPEG\n";
-        return -1;
-    }
-
-    // Release the allocated memory
-    delete[] input_jpeg.buffer;
-    delete[] rChannel;
-    delete[] gChannel;
-    delete[] bChannel;
-    delete[] filteredImage;
-
-    std::cout << "Transformation Complete!" << std::endl;
-    std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
-    return 0;
-}
+//
+// Created by Zhang Na on 2023/9/15.
+// Email: nazhang@link.cuhk.edu.cn
+//
+// OpenMP implementation of transforming a JPEG image from RGB to gray
+//
+
+#include <iostream>
+#include <chrono>
+#include <omp.h>    // OpenMP header
+#include "utils.hpp"
+#include "raw_image.hpp"
+#include "batch.hpp"
+#include "options.hpp"
+#include "convolution.hpp"
+#include "tiling.hpp"
+#include "numa.hpp"
+#include "jpeg_parallel.hpp"
+#include "phases.hpp"
+#include "perf_counters.hpp"
+
+int main(int argc, char** argv) {
+
+    Options options = parse_options(argc, argv);
+    if (options.positional.size() != 3)
+    {
+        std::cerr << "Invalid argument, should be: ./executable "
+                     "/path/to/input/jpeg /path/to/output/jpeg num_threads [--kernel=3] [--mode=auto] [--filter=box] [--tile=WxH|auto] [--numa] [--parallel-decode] [--parallel-encode] [--codec=default] [--quality=N] [--batch] [--queue=2] [--phases[=file]] [--counters]\n";
+        return -1;
+    }
+    // --codec / --quality: libjpeg decoder and encoder settings
+    CodecProfile codec;
+    if (!parse_codec_profile(options.get("codec", "default"), options.get_int("quality", 0), &codec)) {
+        std::cerr << "Unknown codec profile, should be --codec=default|fast|compact and --quality from 1 to 100\n";
+        return -1;
+    }
+    // --phases[=file]: time read, deinterleave, compute, reinterleave (the
+    // last three also per thread) and write, written out as JSON
+    if (options.has("phases")) enable_phase_log();
+    // --counters: cycles, instructions, LLC and dTLB misses of the timed
+    // section, per thread
+    if (options.has("counters")) enable_perf_counters();
+
+    int num_threads = std::stoi(options.positional[2]); // User-specified thread count
+    FilterMode mode = FilterMode::Auto;
+    if (!parse_filter_mode(options.get("mode", "auto"), &mode)) {
+        std::cerr << "Unknown filter mode, should be one of auto, direct, separable, box\n";
+        return -1;
+    }
+    int kernel_size = options.get_int("kernel", 3);
+    if (!is_supported_filter_size(kernel_size, mode)) {
+        std::cerr << "Unsupported kernel size " << kernel_size << ", should be one of 3, 5, 7, 9, 11 (any odd size up to " << MAX_BOX_FILTER_SIZE << " in auto or box mode)\n";
+        return -1;
+    }
+    // --filter: box (equal weights) or gaussian (rank-1, not a box)
+    Filter filter;
+    if (!make_named_filter(options.get("filter", "box"), kernel_size, &filter)) {
+        std::cerr << "Unknown filter, should be --filter=box or --filter=gaussian (kernel size 3, 5, 7, 9 or 11)\n";
+        return -1;
+    }
+    bool numa = options.has("numa");
+    if (numa && options.has("tile")) {
+        std::cerr << "--numa places static row bands and cannot be combined with --tile\n";
+        return -1;
+    }
+    std::vector<int> cpus = allowed_cpus();
+    // --batch: filter every image of a directory (or manifest) into the
+    // output directory, decoding and encoding overlapped with the compute,
+    // which splits each image into static bands of rows
+    if (options.has("batch")) {
+        if (options.has("tile") || numa || options.has("parallel-decode") || options.has("parallel-encode")) {
+            std::cerr << "--batch cannot be combined with --tile, --numa, --parallel-decode or --parallel-encode\n";
+            return -1;
+        }
+        std::vector<std::string> inputs;
+        if (!list_batch_inputs(options.positional[0], &inputs)) {
+            std::cerr << "Cannot list the batch inputs, should be a directory or a manifest file\n";
+            return -1;
+        }
+        return run_batch(inputs, options.positional[1], options.get_int("queue", 2), codec,
+                         [&](const JPEGMeta& input) {
+            auto output = new unsigned char[input.width * input.height * input.num_channels];
+            #pragma omp parallel for schedule(static) num_threads(num_threads)
+            for (int band = 0; band < num_threads; band++) {
+                int start_row = static_cast<long>(input.height) * band / num_threads;
+                int end_row = static_cast<long>(input.height) * (band + 1) / num_threads;
+                convolve_rows(filter, input.num_channels, input.buffer,
+                              output + static_cast<size_t>(start_row) * input.width * input.num_channels,
+                              input.width, input.height, start_row, end_row, mode);
+            }
+            return JPEGMeta{output, input.width, input.height, input.num_channels, input.color_space};
+        });
+    }
+    
+    // Read input JPEG image
+    const char* input_filename = options.positional[0];
+    std::cout << "Input file from: " << input_filename << "\n";
+    // A raw RGB input is mapped and its planes filtered in place: nothing to
+    // decode, nothing to deinterleave
+    PhaseTimer read_timer(Phase::Read);
+    RawImage raw_input{};
+    bool mapped_planes = is_raw_image_path(input_filename) && !options.has("tile") && !numa
+                         && map_raw_image(&raw_input, input_filename) == 0;
+    if (mapped_planes && raw_input.num_channels != 3) {
+        unmap_raw_image(&raw_input);
+        mapped_planes = false;
+    }
+    JPEGMeta input_jpeg{NULL, raw_input.width, raw_input.height, raw_input.num_channels, raw_input.color_space};
+    // --parallel-decode: decode strips between restart markers on all threads
+    if (!mapped_planes)
+        input_jpeg = options.has("parallel-decode") ? read_from_jpeg_reported(input_filename, num_threads, codec)
+                                                    : read_image(input_filename, JCS_UNKNOWN, codec);
+    read_timer.stop();
+    if (input_jpeg.width == 0) {
+        std::cerr << "Failed to read input JPEG image\n";
+        return -1;
+    }
+
+    int width = input_jpeg.width;
+    int height = input_jpeg.height;
+    int num_channels = input_jpeg.num_channels;
+    auto filteredImage = new unsigned char[width * height * num_channels];
+    std::chrono::high_resolution_clock::time_point start_time, end_time;
+
+    if (options.has("tile")) {
+        // Tiled mode: threads take whole cache-sized tiles of the
+        // interleaved image, each tile reads its own halo
+        TileShape shape;
+        if (!parse_tile_shape(options.get("tile", "auto"), width, height, kernel_size, num_channels, &shape)) {
+            std::cerr << "Invalid tile shape, should be --tile=WxH or --tile=auto\n";
+            return -1;
+        }
+        int tiles = num_tiles(shape, width, height);
+        const unsigned char* input = input_jpeg.buffer;
+        std::cout << "Tiles: " << shape.width << "x" << shape.height << " pixels, " << tiles
+                  << " tiles, halo " << kernel_size / 2 << ", L2 " << l2_cache_size() / 1024 << " KB\n";
+
+        PhaseTimer compute_timer(Phase::Compute);
+        start_time = std::chrono::high_resolution_clock::now();
+        #pragma omp parallel default(none) shared(input, filteredImage, filter, mode, width, height, num_channels, shape, tiles) num_threads(num_threads)
+        {
+            ThreadPhaseTimer thread_timer(Phase::Compute);
+            PerfScope counters;
+            #pragma omp for schedule(dynamic) nowait
+            for (int t = 0; t < tiles; t++) {
+                Tile tile = tile_at(shape, width, height, t);
+                convolve_tile(filter, num_channels, input,
+                              filteredImage + static_cast<size_t>(tile.row_begin) * width * num_channels,
+                              width, height, tile.row_begin, tile.row_end, tile.col_begin, tile.col_end, mode);
+            }
+        }
+        end_time = std::chrono::high_resolution_clock::now();
+        compute_timer.stop();
+    } else if (num_channels != 3) {
+        // A gray image has a single plane already: each thread filters its
+        // band of rows straight into the output (with --numa, on the CPU
+        // the band is pinned to, so the output is first touched there)
+        const unsigned char* input = input_jpeg.buffer;
+        PhaseTimer compute_timer(Phase::Compute);
+        start_time = std::chrono::high_resolution_clock::now();
+        #pragma omp parallel for schedule(static) default(none) shared(input, filteredImage, filter, mode, width, height, num_channels, num_threads, numa, cpus) num_threads(num_threads)
+        for (int band = 0; band < num_threads; band++)
+        {
+            if (numa) pin_current_thread(worker_cpu(cpus, band, num_threads));
+            int start_row = static_cast<long>(height) * band / num_threads;
+            int end_row = static_cast<long>(height) * (band + 1) / num_threads;
+            PerfScope counters;
+            ThreadPhaseTimer thread_timer(Phase::Compute);
+            convolve_rows(filter, num_channels, input,
+                          filteredImage + static_cast<size_t>(start_row) * width * num_channels,
+                          width, height, start_row, end_row, mode);
+        }
+        end_time = std::chrono::high_resolution_clock::now();
+        compute_timer.stop();
+    } else {
+        // Separate R, G, B channels into three continuous arrays
+        unsigned char* rChannel = raw_input.planes[0];
+        unsigned char* gChannel = raw_input.planes[1];
+        unsigned char* bChannel = raw_input.planes[2];
+        if (!mapped_planes) {
+            rChannel = new unsigned char[width * height];
+            gChannel = new unsigned char[width * height];
+            bChannel = new unsigned char[width * height];
+        }
+
+        const unsigned char* input = input_jpeg.buffer;
+        PhaseTimer deinterleave_timer(Phase::Deinterleave);
+        if (mapped_planes) {
+            std::cout << "Raw input: R, G, B planes mapped in place\n";
+        } else if (numa) {
+            // Every band is deinterleaved by the pinned thread that filters
+            // it below, so its planes are first touched on that thread's node
+            auto place_start = std::chrono::high_resolution_clock::now();
+            #pragma omp parallel for schedule(static) default(none) shared(input, rChannel, gChannel, bChannel, cpus, width, height, num_channels, num_threads) num_threads(num_threads)
+            for (int band = 0; band < num_threads; band++)
+            {
+                pin_current_thread(worker_cpu(cpus, band, num_threads));
+                ThreadPhaseTimer thread_timer(Phase::Deinterleave);
+                size_t begin = static_cast<size_t>(static_cast<long>(height) * band / num_threads) * width;
+                size_t end = static_cast<size_t>(static_cast<long>(height) * (band + 1) / num_threads) * width;
+                for (size_t i = begin; i < end; i++) {
+                    rChannel[i] = input[i * num_channels];
+                    gChannel[i] = input[i * num_channels + 1];
+                    bChannel[i] = input[i * num_channels + 2];
+                }
+            }
+            auto place_end = std::chrono::high_resolution_clock::now();
+            std::cout << "NUMA: " << num_threads << " bands pinned over " << cpus.size() << " CPUs, "
+                      << numa_node_count() << " node(s), first-touch placement "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(place_end - place_start).count()
+                      << " milliseconds\n";
+        } else {
+            for (int i = 0; i < width * height; i++) {
+                rChannel[i] = input[i * num_channels];
+                gChannel[i] = input[i * num_channels + 1];
+                bChannel[i] = input[i * num_channels + 2];
+            }
+        }
+        deinterleave_timer.stop();
+
+        // Transforming the R, G, B channels
+        auto rSmooth = new unsigned char[width * height];
+        auto gSmooth = new unsigned char[width * height];
+        auto bSmooth = new unsigned char[width * height];
+
+        // The band loop's compute phase includes the interleaving, which
+        // the per-thread timers record apart
+        PhaseTimer compute_timer(Phase::Compute);
+        start_time = std::chrono::high_resolution_clock::now();
+
+        // Each thread filters one band of rows per plane, then interleaves the
+        // band while the planar rows are still hot in cache
+        #pragma omp parallel for schedule(static) default(none) shared(rChannel, gChannel, bChannel, rSmooth, gSmooth, bSmooth, filteredImage, filter, mode, width, height, num_channels, num_threads, numa, cpus) num_threads(num_threads)
+        for (int band = 0; band < num_threads; band++)
+        {
+            // NUMA mode: the first writes of the smoothed planes and of the
+            // output band happen on the band's CPU too
+            if (numa) pin_current_thread(worker_cpu(cpus, band, num_threads));
+            int start_row = static_cast<long>(height) * band / num_threads;
+            int end_row = static_cast<long>(height) * (band + 1) / num_threads;
+            size_t offset = static_cast<size_t>(start_row) * width;
+            PerfScope counters;     // filter and interleave
+            ThreadPhaseTimer thread_timer(Phase::Compute);
+            convolve_rows(filter, 1, rChannel, rSmooth + offset, width, height, start_row, end_row, mode);
+            convolve_rows(filter, 1, gChannel, gSmooth + offset, width, height, start_row, end_row, mode);
+            convolve_rows(filter, 1, bChannel, bSmooth + offset, width, height, start_row, end_row, mode);
+            thread_timer.stop();
+            ThreadPhaseTimer interleave_timer(Phase::Reinterleave);
+            unsigned char* out_rows = filteredImage + offset * num_channels;
+            size_t band_size = static_cast<size_t>(end_row - start_row) * width;
+            for (size_t i = 0; i < band_size; i++) {
+                out_rows[i * num_channels] = rSmooth[offset + i];
+                out_rows[i * num_channels + 1] = gSmooth[offset + i];
+                out_rows[i * num_channels + 2] = bSmooth[offset + i];
+            }
+        }
+        end_time = std::chrono::high_resolution_clock::now();
+        compute_timer.stop();
+
+        if (mapped_planes) {
+            unmap_raw_image(&raw_input);
+        } else {
+            delete[] rChannel;
+            delete[] gChannel;
+            delete[] bChannel;
+        }
+        delete[] rSmooth;
+        delete[] gSmooth;
+        delete[] bSmooth;
+    }
+    auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+
+    // Save output JPEG image
+    const char* output_filepath = options.positional[1];
+    std::cout << "Output file to: " << output_filepath << "\n";
+    JPEGMeta output_jpeg{filteredImage, width, height, num_channels, input_jpeg.color_space};
+    // --parallel-encode: encode strips of MCU rows on all threads
+    PhaseTimer write_timer(Phase::Write);
+    int write_status = options.has("parallel-encode")
+                       ? write_to_jpeg_reported(output_jpeg, output_filepath, num_threads, codec)
+                       : write_image(output_jpeg, output_filepath, codec);
+    write_timer.stop();
+    if (write_status)
+    {
+        std::cerr << "Failed to write output JPEG\n";
+        return -1;
+    }
+
+    // Release the allocated memory
+    delete[] input_jpeg.buffer;
+    delete[] filteredImage;
+
+    std::cout << "Transformation Complete!" << std::endl;
+    std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
+    if (options.has("counters"))
+        print_perf_counters(static_cast<size_t>(width) * height);
+    if (options.has("tile"))
+        print_bandwidth(static_cast<size_t>(width) * height * num_channels, end_time - start_time);
+    if (options.has("phases") && write_phase_log(options.get("phases", "1"), argv[0])) {
+        std::cerr << "Failed to write the phase log\n";
+        return -1;
+    }
+    return 0;
+}
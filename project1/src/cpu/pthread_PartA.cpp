@@ -1,92 +1,145 @@
-//
-// Created by Zhang Na on 2023/9/15.
-// Email: nazhang@link.cuhk.edu.cn
-//
-// Pthread implementation of transforming a JPEG image from RGB to gray
-//
-
-#include <iostream>
-#include <chrono>
-#include <pthread.h>
-#include "utils.hpp"
-
-// Structure to pass data to each thread
-struct ThreadData {
-    unsigned char* input_buffer;
-    unsigned char* output_buffer;
-    int start;
-    int end;
-};
-
-// Function to convert RGB to Grayscale for a portion of the image
-void* rgbToGray(void* arg) {
-    ThreadData* data = reinterpret_cast<ThreadData*>(arg);
-    
-    for (int i = data->start; i < data->end; i++) {
-        unsigned char r = data->input_buffer[i * 3];
-        unsigned char g = data->input_buffer[i * 3 + 1];
-        unsigned char b = data->input_buffer[i * 3 + 2];
-        data->output_buffer[i] = static_cast<unsigned char>(0.299 * r + 0.587 * g + 0.114 * b);
-    }
-
-    return nullptr;
-}
-
-int main(int argc, char** argv) {
-    // Verify input argument format
-    if (argc != 4) {
-        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg num_threads\n";
-        return -1;
-    }
-
-    int num_threads = std::stoi(argv[3]); // User-specified thread count
-
-    // Read from input JPEG
-    const char* input_filepath = argv[1];
-    std::cout << "Input file from: " << input_filepath << "\n";
-    auto input_jpeg = read_from_jpeg(input_filepath);
-
-    // Computation: RGB to Gray
-    auto grayImage = new unsigned char[input_jpeg.width * input_jpeg.height];
-    
-    pthread_t threads[num_threads];
-    ThreadData thread_data[num_threads];
-
-    auto start_time = std::chrono::high_resolution_clock::now();
-
-    int chunk_size = input_jpeg.width * input_jpeg.height / num_threads;
-    for (int i = 0; i < num_threads; i++) {
-        thread_data[i].input_buffer = input_jpeg.buffer;
-        thread_data[i].output_buffer = grayImage;
-        thread_data[i].start = i * chunk_size;
-        thread_data[i].end = (i == num_threads - 1) ? input_jpeg.width * input_jpeg.height : (i + 1) * chunk_size;
-        
-        pthread_create(&threads[i], nullptr, rgbToGray, &thread_data[i]);
-    }
-
-    // Wait for all threads to finish
-    for (int i = 0; i < num_threads; i++) {
-        pthread_join(threads[i], nullptr);
-    }
-
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-
-    // Write GrayImage to output JPEG
-    const char* output_filepath = argv[2];
-    std::cout << "Output file to: " << output_filepath << "\n";
-    JPEGMeta output_jpeg{grayImage, input_jpeg.width, input_jpeg.height, 1, JCS_GRAYSCALE};
-    if (write_to_jpeg(output_jpeg, output_filepath)) {
-        std::cerr << "Failed to write output JPEG\n";
-        return -1;
-    }
-
-    // Release allocated memory
-    delete[] input_jpeg.buffer;
-    delete[] grayImage;
-
-    std::cout << "Transformation Complete!" << std::endl;
-    std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
-
-    return 0;
-}
+//
+// Created by Zhang Na on 2023/9/15.
+// Email: nazhang@link.cuhk.edu.cn
+//
+// Pthread implementation of transforming a JPEG image from RGB to gray
+//
+
+#include <iostream>
+#include <chrono>
+#include <pthread.h>
+#include "utils.hpp"
+#include "raw_image.hpp"
+#include "batch.hpp"
+#include "options.hpp"
+#include "thread_pool.hpp"
+#include "gray.hpp"
+#include "phases.hpp"
+#include "perf_counters.hpp"
+
+// Structure to pass data to each thread
+struct ThreadData {
+    unsigned char* input_buffer;
+    unsigned char* output_buffer;
+    int start;
+    int end;
+};
+
+// Function to convert RGB to Grayscale for a portion of the image
+void* rgbToGray(void* arg) {
+    ThreadData* data = reinterpret_cast<ThreadData*>(arg);
+    ThreadPhaseTimer timer(Phase::Compute);
+    PerfScope counters;
+    rgb_to_gray_fixed(data->input_buffer + static_cast<size_t>(data->start) * 3,
+                      data->output_buffer + data->start, data->end - data->start);
+
+    return nullptr;
+}
+
+int main(int argc, char** argv) {
+    // Verify input argument format
+    Options options = parse_options(argc, argv);
+    if (options.positional.size() != 3) {
+        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg num_threads [--codec=default] [--quality=N] [--batch] [--queue=2] [--phases[=file]] [--counters]\n";
+        return -1;
+    }
+    // --codec / --quality: libjpeg decoder and encoder settings
+    CodecProfile codec;
+    if (!parse_codec_profile(options.get("codec", "default"), options.get_int("quality", 0), &codec)) {
+        std::cerr << "Unknown codec profile, should be --codec=default|fast|compact and --quality from 1 to 100\n";
+        return -1;
+    }
+    // --phases[=file]: time read, compute (also per thread) and write,
+    // written out as JSON
+    if (options.has("phases")) enable_phase_log();
+    // --counters: cycles, instructions, LLC and dTLB misses of the timed
+    // section, per thread
+    if (options.has("counters")) enable_perf_counters();
+
+    int num_threads = std::stoi(options.positional[2]); // User-specified thread count
+
+    // --batch: convert every image of a directory (or manifest) into the
+    // output directory, decoding and encoding overlapped with the compute
+    if (options.has("batch")) {
+        std::vector<std::string> inputs;
+        if (!list_batch_inputs(options.positional[0], &inputs)) {
+            std::cerr << "Cannot list the batch inputs, should be a directory or a manifest file\n";
+            return -1;
+        }
+        ThreadPool pool(num_threads);
+        std::vector<ThreadData> thread_data(num_threads);
+        return run_batch(inputs, options.positional[1], options.get_int("queue", 2), codec,
+                         [&](const JPEGMeta& input) {
+            int num_pixels = input.width * input.height;
+            auto gray = new unsigned char[num_pixels];
+            for (int i = 0; i < num_threads; i++)
+                thread_data[i] = {input.buffer, gray, static_cast<int>(static_cast<long>(num_pixels) * i / num_threads),
+                                  static_cast<int>(static_cast<long>(num_pixels) * (i + 1) / num_threads)};
+            pool.run(rgbToGray, thread_data.data(), num_threads);
+            return JPEGMeta{gray, input.width, input.height, 1, JCS_GRAYSCALE};
+        });
+    }
+
+    // Read from input JPEG
+    const char* input_filepath = options.positional[0];
+    std::cout << "Input file from: " << input_filepath << "\n";
+    PhaseTimer read_timer(Phase::Read);
+    auto input_jpeg = read_image(input_filepath, JCS_UNKNOWN, codec);
+    read_timer.stop();
+    if (input_jpeg.buffer == NULL) {
+        std::cerr << "Failed to read input JPEG image\n";
+        return -1;
+    }
+
+    // Computation: RGB to Gray
+    auto grayImage = new unsigned char[input_jpeg.width * input_jpeg.height];
+    
+    // Workers are started here, outside the timed section, and parked
+    // until the batch of row ranges is submitted
+    ThreadPool pool(num_threads);
+    ThreadData thread_data[num_threads];
+
+    PhaseTimer compute_timer(Phase::Compute);
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    int chunk_size = input_jpeg.width * input_jpeg.height / num_threads;
+    for (int i = 0; i < num_threads; i++) {
+        thread_data[i].input_buffer = input_jpeg.buffer;
+        thread_data[i].output_buffer = grayImage;
+        thread_data[i].start = i * chunk_size;
+        thread_data[i].end = (i == num_threads - 1) ? input_jpeg.width * input_jpeg.height : (i + 1) * chunk_size;
+    }
+
+    // Run the batch on the pool and wait for all slices to finish
+    pool.run(rgbToGray, thread_data, num_threads);
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    compute_timer.stop();
+    auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+
+    // Write GrayImage to output JPEG
+    const char* output_filepath = options.positional[1];
+    std::cout << "Output file to: " << output_filepath << "\n";
+    JPEGMeta output_jpeg{grayImage, input_jpeg.width, input_jpeg.height, 1, JCS_GRAYSCALE};
+    PhaseTimer write_timer(Phase::Write);
+    if (write_image(output_jpeg, output_filepath, codec)) {
+        std::cerr << "Failed to write output JPEG\n";
+        return -1;
+    }
+    write_timer.stop();
+
+    // Release allocated memory
+    delete[] input_jpeg.buffer;
+    delete[] grayImage;
+
+    std::cout << "Transformation Complete!" << std::endl;
+    std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
+    if (options.has("counters"))
+        print_perf_counters(static_cast<size_t>(input_jpeg.width) * input_jpeg.height);
+    if (options.has("phases") && write_phase_log(options.get("phases", "1"), argv[0])) {
+        std::cerr << "Failed to write the phase log\n";
+        return -1;
+    }
+
+    return 0;
+}
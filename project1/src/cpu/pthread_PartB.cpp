@@ -1,157 +1,322 @@
-//
-// Created by Zhang Na on 2023/9/15.
-// Email: nazhang@link.cuhk.edu.cn
-//
-// Pthread implementation of transforming a JPEG image from RGB to gray
-//
-
-#include <iostream>
-#include <chrono>
-#include <cmath>
-#include <pthread.h>
-#include "utils.hpp"
-
-
-const int FILTER_SIZE = 3;
-const double filter[FILTER_SIZE][FILTER_SIZE] = {
-    {1.0 / 9, 1.0 / 9, 1.0 / 9},
-    {1.0 / 9, 1.0 / 9, 1.0 / 9},
-    {1.0 / 9, 1.0 / 9, 1.0 / 9}
-};
-
-// Structure to pass data to each thread
-struct ThreadData {
-    unsigned char* input_buffer;
-    unsigned char* output_buffer;
-    int jpeg_width;
-    int start;
-    int end;
-};
-
-// Smooth RGB
-void* rgbSmooth(void* arg) {
-    ThreadData* data = reinterpret_cast<ThreadData*>(arg);
-    
-    for (int i = data->start; i < data->end; i++) {
-        // int height = i / data->jpeg_width;
-        // int width = i % data->jpeg_width;
-            // finish this redoing thing
-            //0 0
-            int channel_value_r1 = data->input_buffer[(i - data->jpeg_width - 1) * 3] ;
-            int channel_value_g1 = data->input_buffer[(i - data->jpeg_width - 1) * 3 + 1];
-            int channel_value_b1 = data->input_buffer[(i - data->jpeg_width - 1) * 3 + 2];
-            //1 0
-            int channel_value_r2 = data->input_buffer[(i - 1) * 3];
-            int channel_value_g2 = data->input_buffer[(i - 1) * 3 + 1];
-            int channel_value_b2 = data->input_buffer[(i - 1) * 3 + 2];
-            //2 0
-            int channel_value_r3 = data->input_buffer[(i + data->jpeg_width - 1) * 3];
-            int channel_value_g3 = data->input_buffer[(i + data->jpeg_width - 1) * 3 + 1];
-            int channel_value_b3 = data->input_buffer[(i + data->jpeg_width - 1) * 3 + 2];
-            //0 1
-            int channel_value_r4 = data->input_buffer[(i - data->jpeg_width) * 3];
-            int channel_value_g4 = data->input_buffer[(i - data->jpeg_width) * 3 + 1];
-            int channel_value_b4 = data->input_buffer[(i - data->jpeg_width) * 3 + 2];
-            //1 1
-            int channel_value_r5 = data->input_buffer[(i) * 3];
-            int channel_value_g5 = data->input_buffer[(i) * 3 + 1];
-            int channel_value_b5 = data->input_buffer[(i) * 3 + 2];
-            //2 1
-            int channel_value_r6 = data->input_buffer[(i + data->jpeg_width) * 3];
-            int channel_value_g6 = data->input_buffer[(i + data->jpeg_width) * 3 + 1];
-            int channel_value_b6 = data->input_buffer[(i + data->jpeg_width) * 3 + 2];
-            //0 2
-            int channel_value_r7 = data->input_buffer[(i - data->jpeg_width + 1) * 3];
-            int channel_value_g7 = data->input_buffer[(i - data->jpeg_width + 1) * 3 + 1];
-            int channel_value_b7 = data->input_buffer[(i - data->jpeg_width + 1) * 3 + 2];
-            //1 2
-            int channel_value_r8 = data->input_buffer[(i + 1) * 3];
-            int channel_value_g8 = data->input_buffer[(i + 1) * 3 + 1];
-            int channel_value_b8 = data->input_buffer[(i + 1) * 3 + 2];
-            //2 2
-            int channel_value_r9 = data->input_buffer[(i + data->jpeg_width + 1) * 3];
-            int channel_value_g9 = data->input_buffer[(i + data->jpeg_width + 1) * 3 + 1];
-            int channel_value_b9 = data->input_buffer[(i + data->jpeg_width + 1) * 3 + 2];
-
-            int sum_r = channel_value_r1 * filter[0][0]+ channel_value_r2 * filter[1][0]+ channel_value_r3 * filter[2][0]+
-                        channel_value_r4 * filter[0][1]+ channel_value_r5 * filter[1][1]+ channel_value_r6 * filter[2][1]+
-                        channel_value_r7 * filter[0][2]+ channel_value_r8 * filter[1][2]+ channel_value_r9 * filter[2][2];
-            
-            int sum_g = channel_value_g1 * filter[0][0]+ channel_value_g2 * filter[1][0]+ channel_value_g3 * filter[2][0]+
-                        channel_value_g4 * filter[0][1]+ channel_value_g5 * filter[1][1]+ channel_value_g6 * filter[2][1]+
-                        channel_value_g7 * filter[0][2]+ channel_value_g8 * filter[1][2]+ channel_value_g9 * filter[2][2];
-
-            int sum_b = channel_value_b1 * filter[0][0]+ channel_value_b2 * filter[1][0]+ channel_value_b3 * filter[2][0]+
-                        channel_value_b4 * filter[0][1]+ channel_value_b5 * filter[1][1]+ channel_value_b6 * filter[2][1]+
-                        channel_value_b7 * filter[0][2]+ channel_value_b8 * filter[1][2]+ channel_value_b9 * filter[2][2];
-
-            data->output_buffer[i * 3] 
-                = static_cast<unsigned char>(std::round(sum_r));
-            data->output_buffer[i * 3 + 1]
-                = static_cast<unsigned char>(std::round(sum_g));
-            data->output_buffer[i * 3 + 2]
-                = static_cast<unsigned char>(std::round(sum_b));
-    }
-
-    return nullptr;
-}
-
-int main(int argc, char** argv) {
-    // Verify input argument format
-    if (argc != 4) {
-        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg num_threads\n";
-        return -1;
-    }
-
-    int num_threads = std::stoi(argv[3]); // User-specified thread count
-
-    // Read from input JPEG
-    const char* input_filepath = argv[1];
-    std::cout << "Input file from: " << input_filepath << "\n";
-    auto input_jpeg = read_from_jpeg(input_filepath);
-
-    // Computation: RGB to Gray
-    auto filteredImage = new unsigned char[input_jpeg.width * input_jpeg.height * input_jpeg.num_channels];
-    
-    pthread_t threads[num_threads];
-    ThreadData thread_data[num_threads];
-
-    auto start_time = std::chrono::high_resolution_clock::now();
-
-    int chunk_size = input_jpeg.width * input_jpeg.height / num_threads;
-    for (int i = 0; i < num_threads; i++) {
-        thread_data[i].jpeg_width = input_jpeg.width;
-        thread_data[i].input_buffer = input_jpeg.buffer;
-        thread_data[i].output_buffer = filteredImage;
-        thread_data[i].start = i * chunk_size;
-        thread_data[i].end = (i == num_threads - 1) ? input_jpeg.width * input_jpeg.height : (i + 1) * chunk_size;
-        
-        pthread_create(&threads[i], nullptr, rgbSmooth, &thread_data[i]);
-    }
-
-    // Wait for all threads to finish
-    for (int i = 0; i < num_threads; i++) {
-        pthread_join(threads[i], nullptr);
-    }
-
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-
-    // Save output JPEG image
-    const char* output_filepath = argv[2];
-    std::cout << "Output file to: " << output_filepath << "\n";
-    JPEGMeta output_jpeg{filteredImage, input_jpeg.width, input_jpeg.height, input_jpeg.num_channels, input_jpeg.color_space};
-    if (write_to_jpeg(output_jpeg, output_filepath)) {
-        std::cerr << "Failed to write output JPEG\n";
-        return -1;
-    }
-
-    // Release allocated memory
-    delete[] input_jpeg.buffer;
-    delete[] filteredImage;
-
-    std::cout << "Transformation Complete!" << std::endl;
-    std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
-
-    return 0;
-}
+//
+// Created by Zhang Na on 2023/9/15.
+// Email: nazhang@link.cuhk.edu.cn
+//
+// Pthread implementation of transforming a JPEG image from RGB to gray
+//
+
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <pthread.h>
+#include "utils.hpp"
+#include "raw_image.hpp"
+#include "batch.hpp"
+#include "options.hpp"
+#include "convolution.hpp"
+#include "tiling.hpp"
+#include "thread_pool.hpp"
+#include "scheduler.hpp"
+#include "numa.hpp"
+#include "jpeg_parallel.hpp"
+#include "phases.hpp"
+#include "perf_counters.hpp"
+
+// Structure to pass data to each thread
+struct ThreadData {
+    const Filter* filter;
+    FilterMode mode;
+    unsigned char* input_buffer;
+    unsigned char* output_buffer;
+    int jpeg_width;
+    int jpeg_height;
+    int num_channels;
+    int start_row;
+    int end_row;
+    // Tiled mode: tiles are handed out through next_tile
+    const TileShape* tile_shape;
+    int num_tiles;
+    std::atomic<int>* next_tile;
+    // NUMA mode: CPU this band is pinned to (-1 otherwise) and the band's
+    // first-touch copy of the input
+    int cpu;
+    unsigned char* local_input;
+};
+
+// NUMA mode: pin to the band's CPU and first-touch its input rows there
+void* rgbPlaceBand(void* arg) {
+    ThreadData* data = reinterpret_cast<ThreadData*>(arg);
+    pin_current_thread(data->cpu);
+    size_t row_size = static_cast<size_t>(data->jpeg_width) * data->num_channels;
+    std::memcpy(data->local_input + data->start_row * row_size, data->input_buffer + data->start_row * row_size,
+                (data->end_row - data->start_row) * row_size);
+    return nullptr;
+}
+
+// Smooth RGB rows [start_row, end_row)
+void* rgbSmooth(void* arg) {
+    ThreadData* data = reinterpret_cast<ThreadData*>(arg);
+    // Whichever pool worker runs the band moves to the band's CPU, so its
+    // output rows are first touched on the node holding its input rows
+    if (data->cpu >= 0) pin_current_thread(data->cpu);
+    ThreadPhaseTimer timer(Phase::Compute);
+    PerfScope counters;
+    unsigned char* output_rows = data->output_buffer +
+        static_cast<size_t>(data->start_row) * data->jpeg_width * data->num_channels;
+    convolve_rows(*data->filter, data->num_channels, data->input_buffer, output_rows,
+                  data->jpeg_width, data->jpeg_height, data->start_row, data->end_row, data->mode);
+    return nullptr;
+}
+
+// Smooth whole tiles, claimed one at a time until none is left
+void* rgbSmoothTiles(void* arg) {
+    ThreadData* data = reinterpret_cast<ThreadData*>(arg);
+    ThreadPhaseTimer timer(Phase::Compute);
+    PerfScope counters;
+    for (int t = data->next_tile->fetch_add(1); t < data->num_tiles; t = data->next_tile->fetch_add(1)) {
+        Tile tile = tile_at(*data->tile_shape, data->jpeg_width, data->jpeg_height, t);
+        unsigned char* output_rows = data->output_buffer +
+            static_cast<size_t>(tile.row_begin) * data->jpeg_width * data->num_channels;
+        convolve_tile(*data->filter, data->num_channels, data->input_buffer, output_rows,
+                      data->jpeg_width, data->jpeg_height, tile.row_begin, tile.row_end,
+                      tile.col_begin, tile.col_end, data->mode);
+    }
+    return nullptr;
+}
+
+int main(int argc, char** argv) {
+    // Verify input argument format
+    Options options = parse_options(argc, argv);
+    if (options.positional.size() != 3) {
+        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg num_threads [--kernel=3] [--mode=auto] [--filter=box] [--tile=WxH|auto] [--schedule=static|steal] [--grain=16] [--numa] [--parallel-decode] [--parallel-encode] [--codec=default] [--quality=N] [--batch] [--queue=2] [--phases[=file]] [--counters]\n";
+        return -1;
+    }
+    // --codec / --quality: libjpeg decoder and encoder settings
+    CodecProfile codec;
+    if (!parse_codec_profile(options.get("codec", "default"), options.get_int("quality", 0), &codec)) {
+        std::cerr << "Unknown codec profile, should be --codec=default|fast|compact and --quality from 1 to 100\n";
+        return -1;
+    }
+    // --phases[=file]: time read, compute (also per thread) and write,
+    // written out as JSON
+    if (options.has("phases")) enable_phase_log();
+    // --counters: cycles, instructions, LLC and dTLB misses of the timed
+    // section, per thread
+    if (options.has("counters")) enable_perf_counters();
+
+    int num_threads = std::stoi(options.positional[2]); // User-specified thread count
+    FilterMode mode = FilterMode::Auto;
+    if (!parse_filter_mode(options.get("mode", "auto"), &mode)) {
+        std::cerr << "Unknown filter mode, should be one of auto, direct, separable, box\n";
+        return -1;
+    }
+    int kernel_size = options.get_int("kernel", 3);
+    if (!is_supported_filter_size(kernel_size, mode)) {
+        std::cerr << "Unsupported kernel size " << kernel_size << ", should be one of 3, 5, 7, 9, 11 (any odd size up to " << MAX_BOX_FILTER_SIZE << " in auto or box mode)\n";
+        return -1;
+    }
+    // --filter: box (equal weights) or gaussian (rank-1, not a box)
+    Filter filter;
+    if (!make_named_filter(options.get("filter", "box"), kernel_size, &filter)) {
+        std::cerr << "Unknown filter, should be --filter=box or --filter=gaussian (kernel size 3, 5, 7, 9 or 11)\n";
+        return -1;
+    }
+
+    // --batch: filter every image of a directory (or manifest) into the
+    // output directory, decoding and encoding overlapped with the compute,
+    // which runs chunks of `grain` rows on the pool with --schedule
+    if (options.has("batch")) {
+        if (options.has("tile") || options.has("numa") || options.has("parallel-decode") ||
+            options.has("parallel-encode")) {
+            std::cerr << "--batch cannot be combined with --tile, --numa, --parallel-decode or --parallel-encode\n";
+            return -1;
+        }
+        Schedule schedule;
+        int grain = options.get_int("grain", 16);
+        if (!parse_schedule(options.get("schedule", "static"), &schedule) || grain < 1) {
+            std::cerr << "Unknown schedule, should be one of static, steal, with --grain >= 1\n";
+            return -1;
+        }
+        std::vector<std::string> inputs;
+        if (!list_batch_inputs(options.positional[0], &inputs)) {
+            std::cerr << "Cannot list the batch inputs, should be a directory or a manifest file\n";
+            return -1;
+        }
+        ThreadPool pool(num_threads);
+        return run_batch(inputs, options.positional[1], options.get_int("queue", 2), codec,
+                         [&](const JPEGMeta& input) {
+            auto output = new unsigned char[input.width * input.height * input.num_channels];
+            int num_chunks = (input.height + grain - 1) / grain;
+            run_schedule(pool, schedule, num_chunks, [&](int chunk) {
+                int row_begin = chunk * grain;
+                int row_end = std::min(row_begin + grain, input.height);
+                convolve_rows(filter, input.num_channels, input.buffer,
+                              output + static_cast<size_t>(row_begin) * input.width * input.num_channels,
+                              input.width, input.height, row_begin, row_end, mode);
+            });
+            return JPEGMeta{output, input.width, input.height, input.num_channels, input.color_space};
+        });
+    }
+
+    // Read from input JPEG
+    const char* input_filepath = options.positional[0];
+    std::cout << "Input file from: " << input_filepath << "\n";
+    // --parallel-decode: decode strips between restart markers on all threads
+    PhaseTimer read_timer(Phase::Read);
+    auto input_jpeg = options.has("parallel-decode") ? read_from_jpeg_reported(input_filepath, num_threads, codec)
+                                                     : read_image(input_filepath, JCS_UNKNOWN, codec);
+    read_timer.stop();
+    if (input_jpeg.buffer == NULL) {
+        std::cerr << "Failed to read input JPEG image\n";
+        return -1;
+    }
+
+    // Tiled mode: threads claim whole cache-sized tiles instead of bands
+    bool tiled = options.has("tile");
+    TileShape tile_shape{input_jpeg.width, input_jpeg.height};
+    int tile_count = 0;
+    if (tiled) {
+        if (!parse_tile_shape(options.get("tile", "auto"), input_jpeg.width, input_jpeg.height,
+                              kernel_size, input_jpeg.num_channels, &tile_shape)) {
+            std::cerr << "Invalid tile shape, should be --tile=WxH or --tile=auto\n";
+            return -1;
+        }
+        tile_count = num_tiles(tile_shape, input_jpeg.width, input_jpeg.height);
+        std::cout << "Tiles: " << tile_shape.width << "x" << tile_shape.height << " pixels, "
+                  << tile_count << " tiles, halo "
+                  << kernel_size / 2 << ", L2 " << l2_cache_size() / 1024 << " KB\n";
+    }
+    std::atomic<int> next_tile(0);
+
+    // Work-stealing mode: rows are handed out in chunks of `grain` rows
+    Schedule schedule;
+    if (!parse_schedule(options.get("schedule", "static"), &schedule)) {
+        std::cerr << "Unknown schedule, should be one of static, steal\n";
+        return -1;
+    }
+    bool stealing = schedule == Schedule::Steal;
+    int grain = options.get_int("grain", 16);
+    if (stealing && (tiled || grain < 1)) {
+        std::cerr << "--schedule=steal needs --grain >= 1 and cannot be combined with --tile\n";
+        return -1;
+    }
+    int num_chunks = (input_jpeg.height + grain - 1) / grain;
+    long steals = 0;
+
+    // NUMA mode: pinned workers place their own bands of input and output
+    bool numa = options.has("numa");
+    if (numa && (tiled || stealing)) {
+        std::cerr << "--numa places static row bands and cannot be combined with --tile or --schedule=steal\n";
+        return -1;
+    }
+    std::vector<int> cpus = allowed_cpus();
+
+    // Computation: RGB to Gray
+    auto filteredImage = new unsigned char[input_jpeg.width * input_jpeg.height * input_jpeg.num_channels];
+    
+    // Workers are started here, outside the timed section, and parked
+    // until the batch of row ranges (or tile claims) is submitted
+    ThreadPool pool(num_threads);
+    ThreadData thread_data[num_threads];
+
+    // Split the image into bands of whole rows
+    int chunk_size = input_jpeg.height / num_threads;
+    for (int i = 0; i < num_threads; i++) {
+        thread_data[i].filter = &filter;
+        thread_data[i].mode = mode;
+        thread_data[i].input_buffer = input_jpeg.buffer;
+        thread_data[i].output_buffer = filteredImage;
+        thread_data[i].jpeg_width = input_jpeg.width;
+        thread_data[i].jpeg_height = input_jpeg.height;
+        thread_data[i].num_channels = input_jpeg.num_channels;
+        thread_data[i].start_row = i * chunk_size;
+        thread_data[i].end_row = (i == num_threads - 1) ? input_jpeg.height : (i + 1) * chunk_size;
+        thread_data[i].tile_shape = &tile_shape;
+        thread_data[i].num_tiles = tile_count;
+        thread_data[i].next_tile = &next_tile;
+        thread_data[i].cpu = numa ? worker_cpu(cpus, i, num_threads) : -1;
+        thread_data[i].local_input = nullptr;
+    }
+
+    if (numa) {
+        // The decoded image sits on the main thread's node: let each pinned
+        // band copy its rows into a buffer nobody has touched yet
+        auto place_start = std::chrono::high_resolution_clock::now();
+        unsigned char* local_input = new unsigned char[input_jpeg.width * input_jpeg.height * input_jpeg.num_channels];
+        for (int i = 0; i < num_threads; i++)
+            thread_data[i].local_input = local_input;
+        pool.run(rgbPlaceBand, thread_data, num_threads);
+        for (int i = 0; i < num_threads; i++)
+            thread_data[i].input_buffer = local_input;
+        delete[] input_jpeg.buffer;
+        input_jpeg.buffer = local_input;
+        auto place_end = std::chrono::high_resolution_clock::now();
+        std::cout << "NUMA: " << num_threads << " bands pinned over " << cpus.size() << " CPUs, "
+                  << numa_node_count() << " node(s), first-touch placement "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(place_end - place_start).count()
+                  << " milliseconds\n";
+    }
+
+    PhaseTimer compute_timer(Phase::Compute);
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    if (stealing) {
+        // Each worker starts from its own band of chunks and steals from
+        // the others once it is done
+        steals = run_schedule(pool, Schedule::Steal, num_chunks, [&](int chunk) {
+            ThreadPhaseTimer timer(Phase::Compute);
+            PerfScope counters;
+            int row_begin = chunk * grain;
+            int row_end = std::min(row_begin + grain, input_jpeg.height);
+            unsigned char* output_rows = filteredImage +
+                static_cast<size_t>(row_begin) * input_jpeg.width * input_jpeg.num_channels;
+            convolve_rows(filter, input_jpeg.num_channels, input_jpeg.buffer, output_rows,
+                          input_jpeg.width, input_jpeg.height, row_begin, row_end, mode);
+        });
+    } else {
+        // Run the batch on the pool and wait for all bands to finish
+        pool.run(tiled ? rgbSmoothTiles : rgbSmooth, thread_data, num_threads);
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    compute_timer.stop();
+    auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+
+    // Save output JPEG image
+    const char* output_filepath = options.positional[1];
+    std::cout << "Output file to: " << output_filepath << "\n";
+    JPEGMeta output_jpeg{filteredImage, input_jpeg.width, input_jpeg.height, input_jpeg.num_channels, input_jpeg.color_space};
+    // --parallel-encode: encode strips of MCU rows on all threads
+    PhaseTimer write_timer(Phase::Write);
+    int write_status = options.has("parallel-encode")
+                       ? write_to_jpeg_reported(output_jpeg, output_filepath, num_threads, codec)
+                       : write_image(output_jpeg, output_filepath, codec);
+    write_timer.stop();
+    if (write_status) {
+        std::cerr << "Failed to write output JPEG\n";
+        return -1;
+    }
+
+    // Release allocated memory
+    delete[] input_jpeg.buffer;
+    delete[] filteredImage;
+
+    std::cout << "Transformation Complete!" << std::endl;
+    std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
+    if (options.has("counters"))
+        print_perf_counters(static_cast<size_t>(input_jpeg.width) * input_jpeg.height);
+    if (stealing)
+        std::cout << "Schedule: steal, grain " << grain << " rows, " << num_chunks << " chunks, "
+                  << steals << " stolen\n";
+    if (tiled)
+        print_bandwidth(static_cast<size_t>(input_jpeg.width) * input_jpeg.height * input_jpeg.num_channels,
+                        end_time - start_time);
+    if (options.has("phases") && write_phase_log(options.get("phases", "1"), argv[0])) {
+        std::cerr << "Failed to write the phase log\n";
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+//
+// Static vs work-stealing schedule of the pthread filter under background load
+//
+// Runs the PartB filter on a ThreadPool of num_threads workers while 0, 1,
+// ..., max_background extra threads spin on the same cores, and reports the
+// median execution time of both schedules for each load. Both schedules use
+// the same row chunks of `grain` rows; the stealing one should degrade more
+// gracefully as preempted workers fall behind.
+//
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <pthread.h>
+
+#include "utils.hpp"
+#include "raw_image.hpp"
+#include "options.hpp"
+#include "convolution.hpp"
+#include "thread_pool.hpp"
+#include "scheduler.hpp"
+
+// Busy loop standing in for another job on the node
+void* spin(void* arg) {
+    std::atomic<bool>* stop = reinterpret_cast<std::atomic<bool>*>(arg);
+    volatile unsigned long counter = 0;
+    while (!stop->load(std::memory_order_relaxed))
+        counter = counter + 1;
+    return nullptr;
+}
+
+int main(int argc, char** argv) {
+    Options options = parse_options(argc, argv);
+    if (options.positional.size() != 2) {
+        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg num_threads [--background=num_threads] [--grain=16] [--repeats=5] [--kernel=3] [--mode=auto] [--codec=default] [--quality=N]\n";
+        return -1;
+    }
+    // --codec / --quality: libjpeg decoder and encoder settings
+    CodecProfile codec;
+    if (!parse_codec_profile(options.get("codec", "default"), options.get_int("quality", 0), &codec)) {
+        std::cerr << "Unknown codec profile, should be --codec=default|fast|compact and --quality from 1 to 100\n";
+        return -1;
+    }
+    int num_threads = std::stoi(options.positional[1]);
+    int max_background = options.get_int("background", num_threads);
+    int grain = options.get_int("grain", 16);
+    int repeats = options.get_int("repeats", 5);
+    FilterMode mode = FilterMode::Auto;
+    if (!parse_filter_mode(options.get("mode", "auto"), &mode)) {
+        std::cerr << "Unknown filter mode, should be one of auto, direct, separable, box\n";
+        return -1;
+    }
+    int kernel_size = options.get_int("kernel", 3);
+    if (!is_supported_filter_size(kernel_size, mode)) {
+        std::cerr << "Unsupported kernel size " << kernel_size << ", should be one of 3, 5, 7, 9, 11 (any odd size up to " << MAX_BOX_FILTER_SIZE << " in auto or box mode)\n";
+        return -1;
+    }
+    if (num_threads < 1 || max_background < 0 || grain < 1 || repeats < 1) {
+        std::cerr << "num_threads, --grain and --repeats must be positive, --background non-negative\n";
+        return -1;
+    }
+    Filter filter = make_box_filter(kernel_size);
+
+    const char* input_filepath = options.positional[0];
+    std::cout << "Input file from: " << input_filepath << "\n";
+    auto input_jpeg = read_image(input_filepath, JCS_UNKNOWN, codec);
+    if (input_jpeg.buffer == nullptr) {
+        std::cerr << "Failed to read input JPEG image\n";
+        return -1;
+    }
+    size_t image_size = static_cast<size_t>(input_jpeg.width) * input_jpeg.height * input_jpeg.num_channels;
+    auto static_image = new unsigned char[image_size];
+    auto steal_image = new unsigned char[image_size];
+    int num_chunks = (input_jpeg.height + grain - 1) / grain;
+
+    ThreadPool pool(num_threads);
+    std::cout << "Workers: " << num_threads << ", grain " << grain << " rows, " << num_chunks
+              << " chunks, median of " << repeats << " runs\n";
+    std::cout << "Background  Static (ms)  Steal (ms)  Stolen\n";
+
+    for (int background = 0; background <= max_background; background++) {
+        std::atomic<bool> stop(false);
+        std::vector<pthread_t> spinners(background);
+        for (auto& spinner : spinners)
+            pthread_create(&spinner, nullptr, spin, &stop);
+
+        double median_ms[2];
+        long steals = 0;
+        for (int s = 0; s < 2; s++) {
+            Schedule schedule = s == 0 ? Schedule::Static : Schedule::Steal;
+            unsigned char* output = s == 0 ? static_image : steal_image;
+            auto body = [&](int chunk) {
+                int row_begin = chunk * grain;
+                int row_end = std::min(row_begin + grain, input_jpeg.height);
+                convolve_rows(filter, input_jpeg.num_channels, input_jpeg.buffer,
+                              output + static_cast<size_t>(row_begin) * input_jpeg.width * input_jpeg.num_channels,
+                              input_jpeg.width, input_jpeg.height, row_begin, row_end, mode);
+            };
+            std::vector<double> times;
+            for (int r = 0; r < repeats; r++) {
+                auto start_time = std::chrono::high_resolution_clock::now();
+                long stolen = run_schedule(pool, schedule, num_chunks, body);
+                auto end_time = std::chrono::high_resolution_clock::now();
+                times.push_back(std::chrono::duration<double, std::milli>(end_time - start_time).count());
+                steals += stolen;
+            }
+            std::sort(times.begin(), times.end());
+            median_ms[s] = times[times.size() / 2];
+        }
+
+        stop.store(true);
+        for (auto& spinner : spinners)
+            pthread_join(spinner, nullptr);
+
+        std::cout << std::setw(10) << background << std::fixed << std::setprecision(1)
+                  << std::setw(13) << median_ms[0] << std::setw(12) << median_ms[1]
+                  << std::setw(8) << steals / repeats << "\n";
+        if (std::memcmp(static_image, steal_image, image_size) != 0) {
+            std::cerr << "Static and stealing schedules produced different images\n";
+            return -1;
+        }
+    }
+
+    delete[] input_jpeg.buffer;
+    delete[] static_image;
+    delete[] steal_image;
+    return 0;
+}
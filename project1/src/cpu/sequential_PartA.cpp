@@ -1,49 +1,109 @@
-//
-// Created by Liu Yuxuan on 2023/9/15.
-// Email: yuxuanliu1@link.cuhk.edu.cm
-//
-// Sequential implementation of converting a JPEG picture from RGB to gray
-//
-
-#include <iostream>
-#include <chrono>
-
-#include "utils.hpp"
-
-int main(int argc, char** argv) {
-    // Verify input argument format
-    if (argc != 3) {
-        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg\n";
-        return -1;
-    }
-    // Read input JPEG image
-    const char* input_filepath = argv[1];
-    std::cout << "Input file from: " << input_filepath << "\n";
-    auto input_jpeg = read_from_jpeg(input_filepath);
-    // Computation: RGB to Gray
-    auto grayImage = new unsigned char[input_jpeg.width * input_jpeg.height];
-    auto start_time = std::chrono::high_resolution_clock::now();
-    for (int i = 0; i < input_jpeg.width * input_jpeg.height; i++) {
-        unsigned char r = input_jpeg.buffer[i * input_jpeg.num_channels];
-        unsigned char g = input_jpeg.buffer[i * input_jpeg.num_channels + 1];
-        unsigned char b = input_jpeg.buffer[i * input_jpeg.num_channels + 2];
-        grayImage[i] = static_cast<unsigned char>(0.299 * r + 0.587 * g + 0.114 * b);
-    }
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-    // Write GrayImage to output JPEG
-    const char* output_filepath = argv[2];
-    std::cout << "Output file to: " << output_filepath << "\n";
-    JPEGMeta output_jpeg{grayImage, input_jpeg.width, input_jpeg.height, 1, JCS_GRAYSCALE};
-    if (write_to_jpeg(output_jpeg, output_filepath)) {
-        std::cerr << "Failed to write output JPEG\n";
-        return -1;
-    }
-    // Release allocated memory
-    delete[] input_jpeg.buffer;
-    delete[] grayImage;
-    std::cout << "Transformation Complete!" << std::endl;
-    std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
-    return 0;
-}
-
+//
+// Created by Liu Yuxuan on 2023/9/15.
+// Email: yuxuanliu1@link.cuhk.edu.cm
+//
+// Sequential implementation of converting a JPEG picture from RGB to gray
+//
+
+#include <iostream>
+#include <chrono>
+
+#include "utils.hpp"
+#include "raw_image.hpp"
+#include "batch.hpp"
+#include "options.hpp"
+#include "gray.hpp"
+#include "phases.hpp"
+#include "perf_counters.hpp"
+
+int main(int argc, char** argv) {
+    // Verify input argument format
+    Options options = parse_options(argc, argv);
+    if (options.positional.size() != 2) {
+        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg [--decode-gray] [--codec=default] [--quality=N] [--batch] [--queue=2] [--phases[=file]] [--counters]\n";
+        return -1;
+    }
+    // --codec / --quality: libjpeg decoder and encoder settings
+    CodecProfile codec;
+    if (!parse_codec_profile(options.get("codec", "default"), options.get_int("quality", 0), &codec)) {
+        std::cerr << "Unknown codec profile, should be --codec=default|fast|compact and --quality from 1 to 100\n";
+        return -1;
+    }
+    // --phases[=file]: time read, compute and write, written out as JSON
+    if (options.has("phases")) enable_phase_log();
+    // --counters: cycles, instructions, LLC and dTLB misses of the timed
+    // section, per thread
+    if (options.has("counters")) enable_perf_counters();
+    // --decode-gray: let libjpeg output the luma component directly, no
+    // chroma upsampling, color conversion nor RGB to Gray pass (JPEG input
+    // only, a raw image is read as stored)
+    bool decode_gray = options.has("decode-gray") && !is_raw_image_path(options.positional[0]);
+    // --batch: convert every image of a directory (or manifest) into the
+    // output directory, decoding and encoding overlapped with the compute
+    if (options.has("batch")) {
+        if (decode_gray) {
+            std::cerr << "--batch decodes in color and cannot be combined with --decode-gray\n";
+            return -1;
+        }
+        std::vector<std::string> inputs;
+        if (!list_batch_inputs(options.positional[0], &inputs)) {
+            std::cerr << "Cannot list the batch inputs, should be a directory or a manifest file\n";
+            return -1;
+        }
+        return run_batch(inputs, options.positional[1], options.get_int("queue", 2), codec,
+                         [](const JPEGMeta& input) {
+            auto gray = new unsigned char[input.width * input.height];
+            rgb_to_gray_fixed(input.buffer, gray, input.width * input.height);
+            return JPEGMeta{gray, input.width, input.height, 1, JCS_GRAYSCALE};
+        });
+    }
+    auto total_start_time = std::chrono::high_resolution_clock::now();
+    // Read input JPEG image
+    const char* input_filepath = options.positional[0];
+    std::cout << "Input file from: " << input_filepath << "\n";
+    PhaseTimer read_timer(Phase::Read);
+    auto input_jpeg = read_image(input_filepath, decode_gray ? JCS_GRAYSCALE : JCS_UNKNOWN, codec);
+    read_timer.stop();
+    if (input_jpeg.buffer == NULL) {
+        std::cerr << "Failed to read input JPEG image\n";
+        return -1;
+    }
+    // Computation: RGB to Gray
+    auto grayImage = decode_gray ? input_jpeg.buffer : new unsigned char[input_jpeg.width * input_jpeg.height];
+    PhaseTimer compute_timer(Phase::Compute);
+    PerfScope counters;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    if (!decode_gray)
+        rgb_to_gray_fixed(input_jpeg.buffer, grayImage, input_jpeg.width * input_jpeg.height);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    counters.stop();
+    compute_timer.stop();
+    auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    // Write GrayImage to output JPEG
+    const char* output_filepath = options.positional[1];
+    std::cout << "Output file to: " << output_filepath << "\n";
+    JPEGMeta output_jpeg{grayImage, input_jpeg.width, input_jpeg.height, 1, JCS_GRAYSCALE};
+    PhaseTimer write_timer(Phase::Write);
+    if (write_image(output_jpeg, output_filepath, codec)) {
+        std::cerr << "Failed to write output JPEG\n";
+        return -1;
+    }
+    write_timer.stop();
+    auto total_end_time = std::chrono::high_resolution_clock::now();
+    auto total_time = std::chrono::duration_cast<std::chrono::milliseconds>(total_end_time - total_start_time);
+    // Release allocated memory
+    if (grayImage != input_jpeg.buffer)
+        delete[] grayImage;
+    delete[] input_jpeg.buffer;
+    std::cout << "Transformation Complete!" << std::endl;
+    std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
+    if (options.has("counters"))
+        print_perf_counters(static_cast<size_t>(input_jpeg.width) * input_jpeg.height);
+    std::cout << "End-to-end Time (read, convert, write): " << total_time.count() << " milliseconds\n";
+    if (options.has("phases") && write_phase_log(options.get("phases", "1"), argv[0])) {
+        std::cerr << "Failed to write the phase log\n";
+        return -1;
+    }
+    return 0;
+}
+
@@ -1,121 +1,164 @@
-//
-// Created by Liu Yuxuan on 2023/9/15.
-// Email: yuxuanliu1@link.cuhk.edu.cm
-//
-// A naive sequential implementation of image filtering
-//
-
-#include <iostream>
-#include <cmath>
-#include <chrono>
-
-#include "utils.hpp"
-
-const int FILTER_SIZE = 3;
-const double filter[FILTER_SIZE][FILTER_SIZE] = {
-    {1.0 / 9, 1.0 / 9, 1.0 / 9},
-    {1.0 / 9, 1.0 / 9, 1.0 / 9},
-    {1.0 / 9, 1.0 / 9, 1.0 / 9}
-};
-
-int main(int argc, char** argv)
-{
-    if (argc != 3) {
-        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg\n";
-        return -1;
-    }
-    // Read input JPEG image
-    const char* input_filename = argv[1];
-    std::cout << "Input file from: " << input_filename << "\n";
-    auto input_jpeg = read_from_jpeg(input_filename);
-    // Apply the filter to the image
-    auto filteredImage = new unsigned char[input_jpeg.width * input_jpeg.height * input_jpeg.num_channels];
-    for (int i = 0; i < input_jpeg.width * input_jpeg.height * input_jpeg.num_channels; ++i)
-        filteredImage[i] = 0;
-    auto start_time = std::chrono::high_resolution_clock::now();
-    // Nested for loop, please optimize it
-    for (int height = 1; height < input_jpeg.height - 1; height++)
-    {
-        for (int width = 1; width < input_jpeg.width - 1; width++)
-        {
-            //Unrolled 9-length loop
-            //0 0
-            int channel_value_r1 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels] ;
-            int channel_value_g1 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 1];
-            int channel_value_b1 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 2];
-            //1 0
-            int channel_value_r2 = input_jpeg.buffer[((height) * input_jpeg.width + (width-1)) * input_jpeg.num_channels];
-            int channel_value_g2 = input_jpeg.buffer[((height) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 1];
-            int channel_value_b2 = input_jpeg.buffer[((height) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 2];
-            //2 0
-            int channel_value_r3 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels];
-            int channel_value_g3 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 1];
-            int channel_value_b3 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width-1)) * input_jpeg.num_channels + 2];
-            //0 1
-            int channel_value_r4 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width)) * input_jpeg.num_channels];
-            int channel_value_g4 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width)) * input_jpeg.num_channels + 1];
-            int channel_value_b4 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width)) * input_jpeg.num_channels + 2];
-            //1 1
-            int channel_value_r5 = input_jpeg.buffer[((height) * input_jpeg.width + (width)) * input_jpeg.num_channels];
-            int channel_value_g5 = input_jpeg.buffer[((height) * input_jpeg.width + (width)) * input_jpeg.num_channels + 1];
-            int channel_value_b5 = input_jpeg.buffer[((height) * input_jpeg.width + (width)) * input_jpeg.num_channels + 2];
-            //2 1
-            int channel_value_r6 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width)) * input_jpeg.num_channels];
-            int channel_value_g6 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width)) * input_jpeg.num_channels + 1];
-            int channel_value_b6 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width)) * input_jpeg.num_channels + 2];
-            //0 2
-            int channel_value_r7 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels];
-            int channel_value_g7 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 1];
-            int channel_value_b7 = input_jpeg.buffer[((height-1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 2];
-            //1 2
-            int channel_value_r8 = input_jpeg.buffer[((height) * input_jpeg.width + (width+1)) * input_jpeg.num_channels];
-            int channel_value_g8 = input_jpeg.buffer[((height) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 1];
-            int channel_value_b8 = input_jpeg.buffer[((height) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 2];
-            //2 2
-            int channel_value_r9 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels];
-            int channel_value_g9 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 1];
-            int channel_value_b9 = input_jpeg.buffer[((height+1) * input_jpeg.width + (width+1)) * input_jpeg.num_channels + 2];
-
-            int sum_r = channel_value_r1 * filter[0][0]+ channel_value_r2 * filter[1][0]+ channel_value_r3 * filter[2][0]+
-                        channel_value_r4 * filter[0][1]+ channel_value_r5 * filter[1][1]+ channel_value_r6 * filter[2][1]+
-                        channel_value_r7 * filter[0][2]+ channel_value_r8 * filter[1][2]+ channel_value_r9 * filter[2][2];
-            
-            int sum_g = channel_value_g1 * filter[0][0]+ channel_value_g2 * filter[1][0]+ channel_value_g3 * filter[2][0]+
-                        channel_value_g4 * filter[0][1]+ channel_value_g5 * filter[1][1]+ channel_value_g6 * filter[2][1]+
-                        channel_value_g7 * filter[0][2]+ channel_value_g8 * filter[1][2]+ channel_value_g9 * filter[2][2];
-
-            int sum_b = channel_value_b1 * filter[0][0]+ channel_value_b2 * filter[1][0]+ channel_value_b3 * filter[2][0]+
-                        channel_value_b4 * filter[0][1]+ channel_value_b5 * filter[1][1]+ channel_value_b6 * filter[2][1]+
-                        channel_value_b7 * filter[0][2]+ channel_value_b8 * filter[1][2]+ channel_value_b9 * filter[2][2];
-                        
-                            // Back to base
-                            filteredImage[(height * input_jpeg.width + width) *
-                                          input_jpeg.num_channels] =
-                            static_cast<unsigned char>(std::round(sum_r));
-            filteredImage[(height * input_jpeg.width + width) * input_jpeg.num_channels + 1]
-                = static_cast<unsigned char>(std::round(sum_g));
-            filteredImage[(height * input_jpeg.width + width) * input_jpeg.num_channels + 2]
-                = static_cast<unsigned char>(std::round(sum_b));
-        }
-    }
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-    
-    // Save output JPEG image
-    const char* output_filepath = argv[2];
-    std::cout << "Output file to: " << output_filepath << "\n";
-    JPEGMeta output_jpeg{filteredImage, input_jpeg.width, input_jpeg.height, input_jpeg.num_channels, input_jpeg.color_space};
-    if (write_to_jpeg(output_jpeg, output_filepath)) {
-        std::cerr << "Failed to write output JPEG\n";
-        return -1;
-    }
-
-    // Post-processing
-    delete[] input_jpeg.buffer;
-    delete[] filteredImage;
-
-    std::cout << "Transformation Complete!" << std::endl;
-    std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
-
-    return 0;
-}
+//
+// Created by Liu Yuxuan on 2023/9/15.
+// Email: yuxuanliu1@link.cuhk.edu.cm
+//
+// A naive sequential implementation of image filtering
+//
+
+#include <iostream>
+#include <chrono>
+
+#include "utils.hpp"
+#include "raw_image.hpp"
+#include "batch.hpp"
+#include "options.hpp"
+#include "convolution.hpp"
+#include "phases.hpp"
+#include "perf_counters.hpp"
+
+int main(int argc, char** argv)
+{
+    Options options = parse_options(argc, argv);
+    if (options.positional.size() != 2) {
+        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg [--kernel=3] [--mode=auto] [--filter=box] [--stream] [--codec=default] [--quality=N] [--batch] [--queue=2] [--phases[=file]] [--counters]\n";
+        return -1;
+    }
+    // --codec / --quality: libjpeg decoder and encoder settings
+    CodecProfile codec;
+    if (!parse_codec_profile(options.get("codec", "default"), options.get_int("quality", 0), &codec)) {
+        std::cerr << "Unknown codec profile, should be --codec=default|fast|compact and --quality from 1 to 100\n";
+        return -1;
+    }
+    // --phases[=file]: time read, compute and write, written out as JSON
+    if (options.has("phases")) enable_phase_log();
+    // --counters: cycles, instructions, LLC and dTLB misses of the timed
+    // section, per thread
+    if (options.has("counters")) enable_perf_counters();
+    FilterMode mode = FilterMode::Auto;
+    if (!parse_filter_mode(options.get("mode", "auto"), &mode)) {
+        std::cerr << "Unknown filter mode, should be one of auto, direct, separable, box\n";
+        return -1;
+    }
+    int kernel_size = options.get_int("kernel", 3);
+    if (!is_supported_filter_size(kernel_size, mode)) {
+        std::cerr << "Unsupported kernel size " << kernel_size << ", should be one of 3, 5, 7, 9, 11 (any odd size up to " << MAX_BOX_FILTER_SIZE << " in auto or box mode)\n";
+        return -1;
+    }
+    // --filter: box (equal weights) or gaussian (rank-1, not a box)
+    Filter filter;
+    if (!make_named_filter(options.get("filter", "box"), kernel_size, &filter)) {
+        std::cerr << "Unknown filter, should be --filter=box or --filter=gaussian (kernel size 3, 5, 7, 9 or 11)\n";
+        return -1;
+    }
+    // --batch: filter every image of a directory (or manifest) into the
+    // output directory, decoding and encoding overlapped with the compute
+    if (options.has("batch")) {
+        std::vector<std::string> inputs;
+        if (!list_batch_inputs(options.positional[0], &inputs)) {
+            std::cerr << "Cannot list the batch inputs, should be a directory or a manifest file\n";
+            return -1;
+        }
+        return run_batch(inputs, options.positional[1], options.get_int("queue", 2), codec,
+                         [&](const JPEGMeta& input) {
+            auto output = new unsigned char[input.width * input.height * input.num_channels];
+            convolve_rows(filter, input.num_channels, input.buffer, output,
+                          input.width, input.height, 0, input.height, mode);
+            return JPEGMeta{output, input.width, input.height, input.num_channels, input.color_space};
+        });
+    }
+    if (options.has("stream") && (is_raw_image_path(options.positional[0]) || is_raw_image_path(options.positional[1]))) {
+        std::cerr << "--stream works scanline by scanline through libjpeg, it takes JPEG files only\n";
+        return -1;
+    }
+    if (options.has("stream")) {
+        // Decode -> filter -> encode one scanline at a time, the timing
+        // covers the whole pipeline since the three stages interleave
+        const char* input_filename = options.positional[0];
+        const char* output_filepath = options.positional[1];
+        std::cout << "Input file from: " << input_filename << "\n";
+        std::cout << "Output file to: " << output_filepath << "\n";
+        auto start_time = std::chrono::high_resolution_clock::now();
+        JPEGReader reader;
+        if (open_jpeg_reader(&reader, input_filename, JCS_UNKNOWN, codec)) {
+            std::cerr << "Failed to read input JPEG image\n";
+            return -1;
+        }
+        JPEGWriter writer;
+        if (open_jpeg_writer(&writer, reader.width, reader.height, reader.num_channels, reader.color_space, output_filepath, codec)) {
+            std::cerr << "Failed to write output JPEG\n";
+            close_jpeg_reader(&reader);
+            return -1;
+        }
+        // Only the row reads and writes are timed as phases, the rest of
+        // the pipeline is the filter
+        stream_rows(filter, reader.num_channels, reader.width, reader.height, mode,
+                    [&](unsigned char* row) { PhaseTimer timer(Phase::Read); read_jpeg_row(&reader, row); },
+                    [&](const unsigned char* row) { PhaseTimer timer(Phase::Write); write_jpeg_row(&writer, row); });
+        // A failed read or write leaves the later rows alone, both still close
+        int write_failed = close_jpeg_writer(&writer);
+        if (close_jpeg_reader(&reader)) {
+            std::cerr << "Failed to read input JPEG image\n";
+            return -1;
+        }
+        if (write_failed) {
+            std::cerr << "Failed to write output JPEG\n";
+            return -1;
+        }
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cout << "Transformation Complete!" << std::endl;
+        std::cout << "Execution Time (streamed read, filter, write): " << elapsed_time.count() << " milliseconds\n";
+        if (options.has("phases") && write_phase_log(options.get("phases", "1"), argv[0])) {
+            std::cerr << "Failed to write the phase log\n";
+            return -1;
+        }
+        return 0;
+    }
+    // Read input JPEG image
+    const char* input_filename = options.positional[0];
+    std::cout << "Input file from: " << input_filename << "\n";
+    PhaseTimer read_timer(Phase::Read);
+    auto input_jpeg = read_image(input_filename, JCS_UNKNOWN, codec);
+    read_timer.stop();
+    if (input_jpeg.buffer == NULL) {
+        std::cerr << "Failed to read input JPEG image\n";
+        return -1;
+    }
+    // Apply the filter to the image
+    auto filteredImage = new unsigned char[input_jpeg.width * input_jpeg.height * input_jpeg.num_channels];
+    PhaseTimer compute_timer(Phase::Compute);
+    PerfScope counters;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    convolve_rows(filter, input_jpeg.num_channels, input_jpeg.buffer, filteredImage,
+                  input_jpeg.width, input_jpeg.height, 0, input_jpeg.height, mode);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    counters.stop();
+    compute_timer.stop();
+    auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    
+    // Save output JPEG image
+    const char* output_filepath = options.positional[1];
+    std::cout << "Output file to: " << output_filepath << "\n";
+    JPEGMeta output_jpeg{filteredImage, input_jpeg.width, input_jpeg.height, input_jpeg.num_channels, input_jpeg.color_space};
+    PhaseTimer write_timer(Phase::Write);
+    if (write_image(output_jpeg, output_filepath, codec)) {
+        std::cerr << "Failed to write output JPEG\n";
+        return -1;
+    }
+    write_timer.stop();
+
+    // Post-processing
+    delete[] input_jpeg.buffer;
+    delete[] filteredImage;
+
+    std::cout << "Transformation Complete!" << std::endl;
+    std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
+    if (options.has("counters"))
+        print_perf_counters(static_cast<size_t>(input_jpeg.width) * input_jpeg.height);
+    if (options.has("phases") && write_phase_log(options.get("phases", "1"), argv[0])) {
+        std::cerr << "Failed to write the phase log\n";
+        return -1;
+    }
+
+    return 0;
+}
@@ -1,119 +1,108 @@
-//
-// Created by Yang Yufan on 2023/9/16.
-// Email: yufanyang1@link.cuhk.edu.cm
-//
-// SIMD (AVX2) implementation of transferring a JPEG picture from RGB to gray
-//
-
-#include <iostream>
-#include <chrono>
-
-#include <immintrin.h>
-
-#include "utils.hpp"
-
-int main(int argc, char** argv) {
-    // Verify input argument format
-    if (argc != 3) {
-        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg\n";
-        return -1;
-    }
-    // Read JPEG File
-    const char* input_filepath = argv[1];
-    std::cout << "Input file from: " << input_filepath << "\n";
-    auto input_jpeg = read_from_jpeg(input_filepath);
-    if (input_jpeg.buffer == NULL) {
-        std::cerr << "Failed to read input JPEG image\n";
-        return -1;
-    }
-
-    // Transform the RGB Contents to the gray contents
-    auto grayImage = new unsigned char[input_jpeg.width * input_jpeg.height + 8];
-
-    // Prepross, store reds, greens and blues separately
-    auto reds = new unsigned char[input_jpeg.width * input_jpeg.height + 16];
-    auto greens = new unsigned char[input_jpeg.width * input_jpeg.height + 16];
-    auto blues = new unsigned char[input_jpeg.width * input_jpeg.height + 16];
-
-    for (int i = 0; i < input_jpeg.width * input_jpeg.height; i++) {
-        reds[i] = input_jpeg.buffer[i * input_jpeg.num_channels];
-        greens[i] = input_jpeg.buffer[i * input_jpeg.num_channels + 1];
-        blues[i] = input_jpeg.buffer[i * input_jpeg.num_channels + 2];
-    }
-
-    // Set SIMD scalars, we use AVX2 instructions
-    __m256 redScalar = _mm256_set1_ps(0.299f);
-    __m256 greenScalar = _mm256_set1_ps(0.587f);
-    __m256 blueScalar = _mm256_set1_ps(0.114f);
-
-    // Mask used for shuffling when store int32s to u_int8 arrays
-    // |0|0|0|4|0|0|0|3|0|0|0|2|0|0|0|1| -> |4|3|2|1|
-    __m128i shuffle = _mm_setr_epi8(0, 4, 8, 12, 
-                                    -1, -1, -1, -1, 
-                                    -1, -1, -1, -1, 
-                                    -1, -1, -1, -1);
-
-    // Using SIMD to accelerate the transformation
-    auto start_time = std::chrono::high_resolution_clock::now();    // Start recording time
-    for (int i = 0; i < input_jpeg.width * input_jpeg.height; i+=8) {
-        // Load the 8 red chars to a 256 bits float register
-        __m128i red_chars = _mm_loadu_si128((__m128i*) (reds+i));
-        __m256i red_ints = _mm256_cvtepu8_epi32(red_chars);
-        __m256 red_floats = _mm256_cvtepi32_ps(red_ints);
-        // Multiply the red floats to the red scalar
-        __m256 red_results = _mm256_mul_ps(red_floats, redScalar);
-
-        // Load the 8 green chars to a 256 bits float register
-        __m128i green_chars = _mm_loadu_si128((__m128i*) (greens+i));
-        __m256i green_ints = _mm256_cvtepu8_epi32(green_chars);
-        __m256 green_floats = _mm256_cvtepi32_ps(green_ints);
-        // Multiply the green floats to the green scalar
-        __m256 green_results = _mm256_mul_ps(green_floats, greenScalar);
-
-        // Load the 8 blue chars to a 256 bits float register
-        __m128i blue_chars = _mm_loadu_si128((__m128i*) (blues+i));
-        __m256i blue_ints = _mm256_cvtepu8_epi32(blue_chars);
-        __m256 blue_floats = _mm256_cvtepi32_ps(blue_ints);
-        // Multiply the blue floats to the blue scalar
-        __m256 blue_results = _mm256_mul_ps(blue_floats, blueScalar);
-
-        // Add red, green and blue results
-        __m256 add_results = _mm256_add_ps(red_results, green_results);
-        add_results = _mm256_add_ps(add_results, blue_results);
-        // Convert the float32 results to int32
-        __m256i add_results_ints =  _mm256_cvtps_epi32(add_results);
-
-        // Seperate the 256bits result to 2 128bits result
-        __m128i low = _mm256_castsi256_si128(add_results_ints);
-        __m128i high = _mm256_extracti128_si256(add_results_ints, 1);
-
-        // shuffling int32s to u_int8s
-        // |0|0|0|4|0|0|0|3|0|0|0|2|0|0|0|1| -> |4|3|2|1|
-        __m128i trans_low = _mm_shuffle_epi8(low, shuffle);
-        __m128i trans_high = _mm_shuffle_epi8(high, shuffle);
-
-        // Store the results back to gray image
-        _mm_storeu_si128((__m128i*)(&grayImage[i]), trans_low);
-        _mm_storeu_si128((__m128i*)(&grayImage[i+4]), trans_high);
-    }
-
-    auto end_time = std::chrono::high_resolution_clock::now();  // Stop recording time
-    auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-
-    // Save output Gray JPEG Image
-    const char* output_filepath = argv[2];
-    std::cout << "Output file to: " << output_filepath << "\n";
-    JPEGMeta output_jpeg{grayImage, input_jpeg.width, input_jpeg.height, 1, JCS_GRAYSCALE};
-    if (write_to_jpeg(output_jpeg, output_filepath)) {
-        std::cerr << "Failed to write output JPEG\n";
-        return -1;
-    }
-    
-    // Release allocated memory
-    delete[] input_jpeg.buffer;
-    delete[] grayImage;
-    std::cout << "Transformation Complete!" << std::endl;
-    std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
-    return 0;
-}
-
+//
+// Created by Yang Yufan on 2023/9/16.
+// Email: yufanyang1@link.cuhk.edu.cm
+//
+// SIMD (SSE4.1 / AVX2 / AVX-512, picked at startup) implementation of transferring a JPEG picture from RGB to gray
+//
+
+#include <iostream>
+#include <chrono>
+
+#include "utils.hpp"
+#include "raw_image.hpp"
+#include "options.hpp"
+#include "simd_kernels.hpp"
+#include "batch.hpp"
+#include "phases.hpp"
+#include "perf_counters.hpp"
+
+int main(int argc, char** argv) {
+    // Verify input argument format
+    Options options = parse_options(argc, argv);
+    if (options.positional.size() != 2) {
+        std::cerr << "Invalid argument, should be: ./executable /path/to/input/jpeg /path/to/output/jpeg [--isa=avx2] [--codec=default] [--quality=N] [--batch] [--queue=2] [--phases[=file]] [--counters]\n";
+        return -1;
+    }
+    // --codec / --quality: libjpeg decoder and encoder settings
+    CodecProfile codec;
+    if (!parse_codec_profile(options.get("codec", "default"), options.get_int("quality", 0), &codec)) {
+        std::cerr << "Unknown codec profile, should be --codec=default|fast|compact and --quality from 1 to 100\n";
+        return -1;
+    }
+    // --phases[=file]: time read, compute and write, written out as JSON
+    if (options.has("phases")) enable_phase_log();
+    // --counters: cycles, instructions, LLC and dTLB misses of the timed
+    // section, per thread
+    if (options.has("counters")) enable_perf_counters();
+    const SimdKernels* kernels = select_simd_kernels(options.get("isa", ""));
+    if (kernels == nullptr) {
+        std::cerr << "Instruction set " << options.get("isa", "") << " is unknown or not supported by this CPU, should be one of scalar, sse4.1, avx2, avx512bw\n";
+        return -1;
+    }
+    std::cout << "SIMD kernels: " << kernels->isa << "\n";
+    // --batch: convert every image of a directory (or manifest) into the
+    // output directory, decoding and encoding overlapped with the compute
+    if (options.has("batch")) {
+        std::vector<std::string> inputs;
+        if (!list_batch_inputs(options.positional[0], &inputs)) {
+            std::cerr << "Cannot list the batch inputs, should be a directory or a manifest file\n";
+            return -1;
+        }
+        return run_batch(inputs, options.positional[1], options.get_int("queue", 2), codec,
+                         [&](const JPEGMeta& input) {
+            auto gray = new unsigned char[input.width * input.height];
+            kernels->rgb_to_gray(input.buffer, gray, input.width * input.height);
+            return JPEGMeta{gray, input.width, input.height, 1, JCS_GRAYSCALE};
+        });
+    }
+    // Read JPEG File
+    const char* input_filepath = options.positional[0];
+    std::cout << "Input file from: " << input_filepath << "\n";
+    PhaseTimer read_timer(Phase::Read);
+    auto input_jpeg = read_image(input_filepath, JCS_UNKNOWN, codec);
+    read_timer.stop();
+    if (input_jpeg.buffer == NULL) {
+        std::cerr << "Failed to read input JPEG image\n";
+        return -1;
+    }
+
+    // Transform the RGB Contents to the gray contents
+    auto grayImage = new unsigned char[input_jpeg.width * input_jpeg.height];
+
+    // Using SIMD to accelerate the transformation, straight from the
+    // interleaved buffer so the timing covers the whole round trip
+    PhaseTimer compute_timer(Phase::Compute);
+    PerfScope counters;
+    auto start_time = std::chrono::high_resolution_clock::now();    // Start recording time
+    kernels->rgb_to_gray(input_jpeg.buffer, grayImage, input_jpeg.width * input_jpeg.height);
+
+    auto end_time = std::chrono::high_resolution_clock::now();  // Stop recording time
+    counters.stop();
+    compute_timer.stop();
+    auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+
+    // Save output Gray JPEG Image
+    const char* output_filepath = options.positional[1];
+    std::cout << "Output file to: " << output_filepath << "\n";
+    JPEGMeta output_jpeg{grayImage, input_jpeg.width, input_jpeg.height, 1, JCS_GRAYSCALE};
+    PhaseTimer write_timer(Phase::Write);
+    if (write_image(output_jpeg, output_filepath, codec)) {
+        std::cerr << "Failed to write output JPEG\n";
+        return -1;
+    }
+    write_timer.stop();
+    
+    // Release allocated memory
+    delete[] input_jpeg.buffer;
+    delete[] grayImage;
+    std::cout << "Transformation Complete!" << std::endl;
+    std::cout << "Execution Time: " << elapsed_time.count() << " milliseconds\n";
+    if (options.has("counters"))
+        print_perf_counters(static_cast<size_t>(input_jpeg.width) * input_jpeg.height);
+    if (options.has("phases") && write_phase_log(options.get("phases", "1"), argv[0])) {
+        std::cerr << "Failed to write the phase log\n";
+        return -1;
+    }
+    return 0;
+}
+
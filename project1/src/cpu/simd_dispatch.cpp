@@ -0,0 +1,52 @@
+//
+// Scalar fallback of the SIMD kernels and the startup selection between
+// the instruction set variants (baseline flags only)
+//
+
+#include "gray.hpp"
+#include "simd_kernels.hpp"
+
+namespace {
+
+void box3_rows(const unsigned char* in, unsigned char* out, int width, int height,
+               int num_channels, int row_begin, int row_end) {
+    const int C = num_channels;
+    const int stride = width * C;
+    for (int y = row_begin; y < row_end; y++) {
+        unsigned char* dst = out + static_cast<size_t>(y - row_begin) * stride;
+        for (int i = 0; i < stride; i++) {
+            if (y < 1 || y >= height - 1 || i < C || i >= stride - C) {
+                dst[i] = 0;
+                continue;
+            }
+            int sum = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                const unsigned char* row = in + static_cast<size_t>(y + dy) * stride;
+                sum += row[i - C] + row[i] + row[i + C];
+            }
+            dst[i] = static_cast<unsigned char>(((sum + 4) * RECIPROCAL_9) >> 16);
+        }
+    }
+}
+
+} // namespace
+
+const SimdKernels scalar_kernels = {"scalar", rgb_to_gray_fixed, box3_rows};
+
+const SimdKernels* select_simd_kernels(const std::string& isa) {
+    __builtin_cpu_init();
+    const bool has_sse41 = __builtin_cpu_supports("sse4.1");
+    const bool has_avx2 = __builtin_cpu_supports("avx2");
+    const bool has_avx512bw = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    if (isa.empty()) {
+        if (has_avx512bw) return &avx512bw_kernels;
+        if (has_avx2) return &avx2_kernels;
+        if (has_sse41) return &sse41_kernels;
+        return &scalar_kernels;
+    }
+    if (isa == "scalar") return &scalar_kernels;
+    if (isa == "sse4.1") return has_sse41 ? &sse41_kernels : nullptr;
+    if (isa == "avx2") return has_avx2 ? &avx2_kernels : nullptr;
+    if (isa == "avx512bw") return has_avx512bw ? &avx512bw_kernels : nullptr;
+    return nullptr;
+}
@@ -0,0 +1,51 @@
+//
+// SIMD kernels of simd_PartA / simd_PartB, built once per instruction set
+//
+// Every simd_kernels_<isa>.cpp is compiled with its own -m flags and only
+// exports a SimdKernels table; select_simd_kernels() picks the best table
+// the CPU supports at startup, so one binary runs everywhere.
+//
+// The ISA translation units must not instantiate inline functions or
+// templates shared with other translation units (the linker would keep
+// just one copy, possibly built for a wider ISA than the caller's CPU).
+//
+
+#ifndef CSC4005_PROJECT_1_SIMD_KERNELS_HPP
+#define CSC4005_PROJECT_1_SIMD_KERNELS_HPP
+
+#include <string>
+
+// Fixed-point reciprocal of 9: (s * 7282) >> 16 == s / 9 for s <= 2299
+const int RECIPROCAL_9 = 7282;
+
+struct SimdKernels {
+    const char* isa;
+    /**
+     * Convert num_pixels interleaved RGB pixels to gray with the integer
+     * formula of gray.hpp (bit-exact across all variants)
+     */
+    void (*rgb_to_gray)(const unsigned char* rgb, unsigned char* gray, int num_pixels);
+    /**
+     * 3x3 equal weight filter of rows [row_begin, row_end) in 16-bit fixed
+     * point. The mean is round(sum / 9) with halves rounded up, computed as
+     * ((sum + 4) * RECIPROCAL_9) >> 16, which is exact for every possible
+     * sum, so all variants are bit-exact with convolve_rows.
+     * Rows outside [1, height - 1) and the border pixels are set to 0.
+     */
+    void (*box3_rows)(const unsigned char* in, unsigned char* out, int width, int height,
+                      int num_channels, int row_begin, int row_end);
+};
+
+extern const SimdKernels scalar_kernels;
+extern const SimdKernels sse41_kernels;
+extern const SimdKernels avx2_kernels;
+extern const SimdKernels avx512bw_kernels;
+
+/**
+ * Kernels for the widest instruction set this CPU supports, or for the one
+ * named by `isa` ("scalar", "sse4.1", "avx2", "avx512bw") when not empty.
+ * @return nullptr if the name is unknown or the CPU lacks the extension
+ */
+const SimdKernels* select_simd_kernels(const std::string& isa);
+
+#endif // CSC4005_PROJECT_1_SIMD_KERNELS_HPP
@@ -0,0 +1,141 @@
+//
+// AVX2 variant of the SIMD kernels, compiled with -mavx2
+//
+
+#include <immintrin.h>
+
+#include <cstring>
+
+#include "gray.hpp"
+#include "simd_kernels.hpp"
+
+namespace {
+
+/**
+ * Convert interleaved RGB pixels to gray, 32 pixels per iteration.
+ * Each 128-bit lane deinterleaves 16 pixels (48 bytes) with three pshufb
+ * per channel, so no planar copy of the image is needed; the weighting is
+ * the Q14 integer formula of gray.hpp.
+ */
+void rgb_to_gray(const unsigned char* rgb, unsigned char* gray, int num_pixels) {
+    // Byte k of the R / G / B result is gathered from the a, b or c load
+    // (bytes 0-15, 16-31, 32-47 of the 16 pixels), -1 writes zero
+    const __m256i red_a = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    const __m256i red_b = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1));
+    const __m256i red_c = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13));
+    const __m256i green_a = _mm256_broadcastsi128_si256(_mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    const __m256i green_b = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1));
+    const __m256i green_c = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14));
+    const __m256i blue_a = _mm256_broadcastsi128_si256(_mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    const __m256i blue_b = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1));
+    const __m256i blue_c = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15));
+
+    // (r, g) and (b, 1) 16-bit pairs are weighted with one madd each,
+    // the constant 1 in the blue pair adds the rounding term
+    const __m256i weights_rg = _mm256_set1_epi32((GRAY_WEIGHT_G << 16) | GRAY_WEIGHT_R);
+    const __m256i weights_b1 = _mm256_set1_epi32((GRAY_ROUNDING << 16) | GRAY_WEIGHT_B);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi16(1);
+
+    int i = 0;
+    for (; i + 32 <= num_pixels; i += 32) {
+        // Low lane: pixels i .. i+15, high lane: pixels i+16 .. i+31
+        const unsigned char* p = rgb + i * 3;
+        __m256i a = _mm256_loadu2_m128i((const __m128i*)(p + 48), (const __m128i*)p);
+        __m256i b = _mm256_loadu2_m128i((const __m128i*)(p + 64), (const __m128i*)(p + 16));
+        __m256i c = _mm256_loadu2_m128i((const __m128i*)(p + 80), (const __m128i*)(p + 32));
+        __m256i reds = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(a, red_a), _mm256_shuffle_epi8(b, red_b)),
+                                       _mm256_shuffle_epi8(c, red_c));
+        __m256i greens = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(a, green_a), _mm256_shuffle_epi8(b, green_b)),
+                                         _mm256_shuffle_epi8(c, green_c));
+        __m256i blues = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(a, blue_a), _mm256_shuffle_epi8(b, blue_b)),
+                                        _mm256_shuffle_epi8(c, blue_c));
+
+        // Everything below works within 128-bit lanes: quarter k holds
+        // pixels 4k .. 4k+3 of each lane, and the packs restore the order
+        __m256i r16[2] = {_mm256_unpacklo_epi8(reds, zero), _mm256_unpackhi_epi8(reds, zero)};
+        __m256i g16[2] = {_mm256_unpacklo_epi8(greens, zero), _mm256_unpackhi_epi8(greens, zero)};
+        __m256i b16[2] = {_mm256_unpacklo_epi8(blues, zero), _mm256_unpackhi_epi8(blues, zero)};
+        __m256i quarters[4];
+        for (int k = 0; k < 4; k++) {
+            __m256i rg = k % 2 ? _mm256_unpackhi_epi16(r16[k / 2], g16[k / 2]) : _mm256_unpacklo_epi16(r16[k / 2], g16[k / 2]);
+            __m256i b1 = k % 2 ? _mm256_unpackhi_epi16(b16[k / 2], one) : _mm256_unpacklo_epi16(b16[k / 2], one);
+            __m256i sum = _mm256_add_epi32(_mm256_madd_epi16(rg, weights_rg), _mm256_madd_epi16(b1, weights_b1));
+            quarters[k] = _mm256_srli_epi32(sum, GRAY_SHIFT);
+        }
+        __m256i low = _mm256_packs_epi32(quarters[0], quarters[1]);
+        __m256i high = _mm256_packs_epi32(quarters[2], quarters[3]);
+        _mm256_storeu_si256((__m256i*)(gray + i), _mm256_packus_epi16(low, high));
+    }
+    for (; i < num_pixels; i++)
+        gray[i] = rgb_to_gray_pixel(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+}
+
+/**
+ * 3x3 equal weight filter, 32 elements per iteration.
+ * The 9 neighbours are widened to 16-bit lanes and summed with
+ * _mm256_add_epi16 (at most 9 * 255 = 2295, no overflow), then the mean
+ * is taken with a multiply-high by RECIPROCAL_9.
+ * C is the distance between horizontal neighbours (1 planar, 3 interleaved).
+ */
+template <int C>
+void box3_fixed_point_rows(const unsigned char* in, unsigned char* out,
+                           int width, int height, int row_begin, int row_end) {
+    const int stride = width * C;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i bias = _mm256_set1_epi16(4);
+    const __m256i reciprocal = _mm256_set1_epi16(RECIPROCAL_9);
+    for (int y = row_begin; y < row_end; y++) {
+        unsigned char* dst = out + static_cast<size_t>(y - row_begin) * stride;
+        if (y < 1 || y >= height - 1 || width < 3) {
+            std::memset(dst, 0, stride);
+            continue;
+        }
+        std::memset(dst, 0, C);
+        std::memset(dst + stride - C, 0, C);
+        const unsigned char* rows[3] = {in + static_cast<size_t>(y - 1) * stride,
+                                        in + static_cast<size_t>(y) * stride,
+                                        in + static_cast<size_t>(y + 1) * stride};
+        const int end = stride - C;
+        int i = C;
+        for (; i + 32 <= end; i += 32) {
+            // unpack keeps bytes in-lane: lo holds elements 0-7 / 16-23,
+            // hi holds 8-15 / 24-31, and packus restores the order
+            __m256i sum_lo = zero;
+            __m256i sum_hi = zero;
+            for (int r = 0; r < 3; r++) {
+                __m256i left = _mm256_loadu_si256((const __m256i*)(rows[r] + i - C));
+                __m256i center = _mm256_loadu_si256((const __m256i*)(rows[r] + i));
+                __m256i right = _mm256_loadu_si256((const __m256i*)(rows[r] + i + C));
+                sum_lo = _mm256_add_epi16(sum_lo, _mm256_unpacklo_epi8(left, zero));
+                sum_hi = _mm256_add_epi16(sum_hi, _mm256_unpackhi_epi8(left, zero));
+                sum_lo = _mm256_add_epi16(sum_lo, _mm256_unpacklo_epi8(center, zero));
+                sum_hi = _mm256_add_epi16(sum_hi, _mm256_unpackhi_epi8(center, zero));
+                sum_lo = _mm256_add_epi16(sum_lo, _mm256_unpacklo_epi8(right, zero));
+                sum_hi = _mm256_add_epi16(sum_hi, _mm256_unpackhi_epi8(right, zero));
+            }
+            __m256i mean_lo = _mm256_mulhi_epu16(_mm256_add_epi16(sum_lo, bias), reciprocal);
+            __m256i mean_hi = _mm256_mulhi_epu16(_mm256_add_epi16(sum_hi, bias), reciprocal);
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(mean_lo, mean_hi));
+        }
+        // Scalar tail with the same rounding rule
+        for (; i < end; i++) {
+            int sum = 0;
+            for (int r = 0; r < 3; r++)
+                sum += rows[r][i - C] + rows[r][i] + rows[r][i + C];
+            dst[i] = static_cast<unsigned char>(((sum + 4) * RECIPROCAL_9) >> 16);
+        }
+    }
+}
+
+void box3_rows(const unsigned char* in, unsigned char* out, int width, int height,
+               int num_channels, int row_begin, int row_end) {
+    if (num_channels == 1)
+        box3_fixed_point_rows<1>(in, out, width, height, row_begin, row_end);
+    else
+        box3_fixed_point_rows<3>(in, out, width, height, row_begin, row_end);
+}
+
+} // namespace
+
+const SimdKernels avx2_kernels = {"avx2", rgb_to_gray, box3_rows};
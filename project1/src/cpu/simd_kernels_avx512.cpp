@@ -0,0 +1,143 @@
+//
+// AVX-512 variant of the SIMD kernels, compiled with -mavx512f -mavx512bw
+//
+
+#include <immintrin.h>
+
+#include <cstring>
+
+#include "gray.hpp"
+#include "simd_kernels.hpp"
+
+namespace {
+
+// Four 16-byte loads 48 bytes apart, one per 128-bit lane
+__m512i load_lanes(const unsigned char* p) {
+    __m512i v = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i*)p));
+    v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i*)(p + 48)), 1);
+    v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i*)(p + 96)), 2);
+    v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i*)(p + 144)), 3);
+    return v;
+}
+
+/**
+ * Convert interleaved RGB pixels to gray, 64 pixels per iteration.
+ * Each 128-bit lane deinterleaves 16 pixels (48 bytes) with three pshufb
+ * per channel and weighted with the Q14 integer formula, like the AVX2
+ * variant.
+ */
+void rgb_to_gray(const unsigned char* rgb, unsigned char* gray, int num_pixels) {
+    // Byte k of the R / G / B result is gathered from the a, b or c load
+    // (bytes 0-15, 16-31, 32-47 of the 16 pixels), -1 writes zero
+    const __m512i red_a = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    const __m512i red_b = _mm512_broadcast_i32x4(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1));
+    const __m512i red_c = _mm512_broadcast_i32x4(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13));
+    const __m512i green_a = _mm512_broadcast_i32x4(_mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    const __m512i green_b = _mm512_broadcast_i32x4(_mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1));
+    const __m512i green_c = _mm512_broadcast_i32x4(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14));
+    const __m512i blue_a = _mm512_broadcast_i32x4(_mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    const __m512i blue_b = _mm512_broadcast_i32x4(_mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1));
+    const __m512i blue_c = _mm512_broadcast_i32x4(_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15));
+
+    // (r, g) and (b, 1) 16-bit pairs are weighted with one madd each,
+    // the constant 1 in the blue pair adds the rounding term
+    const __m512i weights_rg = _mm512_set1_epi32((GRAY_WEIGHT_G << 16) | GRAY_WEIGHT_R);
+    const __m512i weights_b1 = _mm512_set1_epi32((GRAY_ROUNDING << 16) | GRAY_WEIGHT_B);
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i one = _mm512_set1_epi16(1);
+
+    int i = 0;
+    for (; i + 64 <= num_pixels; i += 64) {
+        // Lane k: pixels i + 16k .. i + 16k + 15
+        const unsigned char* p = rgb + i * 3;
+        __m512i a = load_lanes(p);
+        __m512i b = load_lanes(p + 16);
+        __m512i c = load_lanes(p + 32);
+        __m512i reds = _mm512_or_si512(_mm512_or_si512(_mm512_shuffle_epi8(a, red_a), _mm512_shuffle_epi8(b, red_b)),
+                                       _mm512_shuffle_epi8(c, red_c));
+        __m512i greens = _mm512_or_si512(_mm512_or_si512(_mm512_shuffle_epi8(a, green_a), _mm512_shuffle_epi8(b, green_b)),
+                                         _mm512_shuffle_epi8(c, green_c));
+        __m512i blues = _mm512_or_si512(_mm512_or_si512(_mm512_shuffle_epi8(a, blue_a), _mm512_shuffle_epi8(b, blue_b)),
+                                        _mm512_shuffle_epi8(c, blue_c));
+        // Quarter k holds pixels 4k .. 4k+3 of each lane, the packs
+        // restore the order within the lanes
+        __m512i r16[2] = {_mm512_unpacklo_epi8(reds, zero), _mm512_unpackhi_epi8(reds, zero)};
+        __m512i g16[2] = {_mm512_unpacklo_epi8(greens, zero), _mm512_unpackhi_epi8(greens, zero)};
+        __m512i b16[2] = {_mm512_unpacklo_epi8(blues, zero), _mm512_unpackhi_epi8(blues, zero)};
+        __m512i quarters[4];
+        for (int k = 0; k < 4; k++) {
+            __m512i rg = k % 2 ? _mm512_unpackhi_epi16(r16[k / 2], g16[k / 2]) : _mm512_unpacklo_epi16(r16[k / 2], g16[k / 2]);
+            __m512i b1 = k % 2 ? _mm512_unpackhi_epi16(b16[k / 2], one) : _mm512_unpacklo_epi16(b16[k / 2], one);
+            __m512i sum = _mm512_add_epi32(_mm512_madd_epi16(rg, weights_rg), _mm512_madd_epi16(b1, weights_b1));
+            quarters[k] = _mm512_srli_epi32(sum, GRAY_SHIFT);
+        }
+        __m512i low = _mm512_packs_epi32(quarters[0], quarters[1]);
+        __m512i high = _mm512_packs_epi32(quarters[2], quarters[3]);
+        _mm512_storeu_si512((void*)(gray + i), _mm512_packus_epi16(low, high));
+    }
+    for (; i < num_pixels; i++)
+        gray[i] = rgb_to_gray_pixel(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+}
+
+/**
+ * 3x3 equal weight filter, 64 elements per iteration, see the AVX2 variant
+ */
+template <int C>
+void box3_fixed_point_rows(const unsigned char* in, unsigned char* out,
+                           int width, int height, int row_begin, int row_end) {
+    const int stride = width * C;
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i bias = _mm512_set1_epi16(4);
+    const __m512i reciprocal = _mm512_set1_epi16(RECIPROCAL_9);
+    for (int y = row_begin; y < row_end; y++) {
+        unsigned char* dst = out + static_cast<size_t>(y - row_begin) * stride;
+        if (y < 1 || y >= height - 1 || width < 3) {
+            std::memset(dst, 0, stride);
+            continue;
+        }
+        std::memset(dst, 0, C);
+        std::memset(dst + stride - C, 0, C);
+        const unsigned char* rows[3] = {in + static_cast<size_t>(y - 1) * stride,
+                                        in + static_cast<size_t>(y) * stride,
+                                        in + static_cast<size_t>(y + 1) * stride};
+        const int end = stride - C;
+        int i = C;
+        for (; i + 64 <= end; i += 64) {
+            __m512i sum_lo = zero;
+            __m512i sum_hi = zero;
+            for (int r = 0; r < 3; r++) {
+                __m512i left = _mm512_loadu_si512((const void*)(rows[r] + i - C));
+                __m512i center = _mm512_loadu_si512((const void*)(rows[r] + i));
+                __m512i right = _mm512_loadu_si512((const void*)(rows[r] + i + C));
+                sum_lo = _mm512_add_epi16(sum_lo, _mm512_unpacklo_epi8(left, zero));
+                sum_hi = _mm512_add_epi16(sum_hi, _mm512_unpackhi_epi8(left, zero));
+                sum_lo = _mm512_add_epi16(sum_lo, _mm512_unpacklo_epi8(center, zero));
+                sum_hi = _mm512_add_epi16(sum_hi, _mm512_unpackhi_epi8(center, zero));
+                sum_lo = _mm512_add_epi16(sum_lo, _mm512_unpacklo_epi8(right, zero));
+                sum_hi = _mm512_add_epi16(sum_hi, _mm512_unpackhi_epi8(right, zero));
+            }
+            __m512i mean_lo = _mm512_mulhi_epu16(_mm512_add_epi16(sum_lo, bias), reciprocal);
+            __m512i mean_hi = _mm512_mulhi_epu16(_mm512_add_epi16(sum_hi, bias), reciprocal);
+            _mm512_storeu_si512((void*)(dst + i), _mm512_packus_epi16(mean_lo, mean_hi));
+        }
+        // Scalar tail with the same rounding rule
+        for (; i < end; i++) {
+            int sum = 0;
+            for (int r = 0; r < 3; r++)
+                sum += rows[r][i - C] + rows[r][i] + rows[r][i + C];
+            dst[i] = static_cast<unsigned char>(((sum + 4) * RECIPROCAL_9) >> 16);
+        }
+    }
+}
+
+void box3_rows(const unsigned char* in, unsigned char* out, int width, int height,
+               int num_channels, int row_begin, int row_end) {
+    if (num_channels == 1)
+        box3_fixed_point_rows<1>(in, out, width, height, row_begin, row_end);
+    else
+        box3_fixed_point_rows<3>(in, out, width, height, row_begin, row_end);
+}
+
+} // namespace
+
+const SimdKernels avx512bw_kernels = {"avx512bw", rgb_to_gray, box3_rows};
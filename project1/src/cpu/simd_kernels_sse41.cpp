@@ -0,0 +1,132 @@
+//
+// SSE4.1 variant of the SIMD kernels, compiled with -msse4.1
+//
+
+#include <immintrin.h>
+
+#include <cstring>
+
+#include "gray.hpp"
+#include "simd_kernels.hpp"
+
+namespace {
+
+/**
+ * Convert interleaved RGB pixels to gray, 16 pixels (48 bytes) per
+ * iteration, deinterleaved with three pshufb per channel and weighted with
+ * the Q14 integer formula of gray.hpp
+ */
+void rgb_to_gray(const unsigned char* rgb, unsigned char* gray, int num_pixels) {
+    // Byte k of the R / G / B result is gathered from the a, b or c load
+    // (bytes 0-15, 16-31, 32-47 of the 16 pixels), -1 writes zero
+    const __m128i red_a = _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i red_b = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1);
+    const __m128i red_c = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13);
+    const __m128i green_a = _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i green_b = _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1);
+    const __m128i green_c = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14);
+    const __m128i blue_a = _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i blue_b = _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1);
+    const __m128i blue_c = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15);
+
+    // (r, g) and (b, 1) 16-bit pairs are weighted with one madd each,
+    // the constant 1 in the blue pair adds the rounding term
+    const __m128i weights_rg = _mm_set1_epi32((GRAY_WEIGHT_G << 16) | GRAY_WEIGHT_R);
+    const __m128i weights_b1 = _mm_set1_epi32((GRAY_ROUNDING << 16) | GRAY_WEIGHT_B);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+
+    int i = 0;
+    for (; i + 16 <= num_pixels; i += 16) {
+        const unsigned char* p = rgb + i * 3;
+        __m128i a = _mm_loadu_si128((const __m128i*)p);
+        __m128i b = _mm_loadu_si128((const __m128i*)(p + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(p + 32));
+        __m128i reds = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, red_a), _mm_shuffle_epi8(b, red_b)),
+                                    _mm_shuffle_epi8(c, red_c));
+        __m128i greens = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, green_a), _mm_shuffle_epi8(b, green_b)),
+                                      _mm_shuffle_epi8(c, green_c));
+        __m128i blues = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, blue_a), _mm_shuffle_epi8(b, blue_b)),
+                                     _mm_shuffle_epi8(c, blue_c));
+
+        // Quarter k holds pixels 4k .. 4k+3, the packs keep pixel order
+        __m128i r16[2] = {_mm_unpacklo_epi8(reds, zero), _mm_unpackhi_epi8(reds, zero)};
+        __m128i g16[2] = {_mm_unpacklo_epi8(greens, zero), _mm_unpackhi_epi8(greens, zero)};
+        __m128i b16[2] = {_mm_unpacklo_epi8(blues, zero), _mm_unpackhi_epi8(blues, zero)};
+        __m128i quarters[4];
+        for (int k = 0; k < 4; k++) {
+            __m128i rg = k % 2 ? _mm_unpackhi_epi16(r16[k / 2], g16[k / 2]) : _mm_unpacklo_epi16(r16[k / 2], g16[k / 2]);
+            __m128i b1 = k % 2 ? _mm_unpackhi_epi16(b16[k / 2], one) : _mm_unpacklo_epi16(b16[k / 2], one);
+            __m128i sum = _mm_add_epi32(_mm_madd_epi16(rg, weights_rg), _mm_madd_epi16(b1, weights_b1));
+            quarters[k] = _mm_srli_epi32(sum, GRAY_SHIFT);
+        }
+        __m128i low = _mm_packs_epi32(quarters[0], quarters[1]);
+        __m128i high = _mm_packs_epi32(quarters[2], quarters[3]);
+        _mm_storeu_si128((__m128i*)(gray + i), _mm_packus_epi16(low, high));
+    }
+    for (; i < num_pixels; i++)
+        gray[i] = rgb_to_gray_pixel(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+}
+
+/**
+ * 3x3 equal weight filter, 16 elements per iteration, see the AVX2 variant
+ */
+template <int C>
+void box3_fixed_point_rows(const unsigned char* in, unsigned char* out,
+                           int width, int height, int row_begin, int row_end) {
+    const int stride = width * C;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16(4);
+    const __m128i reciprocal = _mm_set1_epi16(RECIPROCAL_9);
+    for (int y = row_begin; y < row_end; y++) {
+        unsigned char* dst = out + static_cast<size_t>(y - row_begin) * stride;
+        if (y < 1 || y >= height - 1 || width < 3) {
+            std::memset(dst, 0, stride);
+            continue;
+        }
+        std::memset(dst, 0, C);
+        std::memset(dst + stride - C, 0, C);
+        const unsigned char* rows[3] = {in + static_cast<size_t>(y - 1) * stride,
+                                        in + static_cast<size_t>(y) * stride,
+                                        in + static_cast<size_t>(y + 1) * stride};
+        const int end = stride - C;
+        int i = C;
+        for (; i + 16 <= end; i += 16) {
+            __m128i sum_lo = zero;
+            __m128i sum_hi = zero;
+            for (int r = 0; r < 3; r++) {
+                __m128i left = _mm_loadu_si128((const __m128i*)(rows[r] + i - C));
+                __m128i center = _mm_loadu_si128((const __m128i*)(rows[r] + i));
+                __m128i right = _mm_loadu_si128((const __m128i*)(rows[r] + i + C));
+                sum_lo = _mm_add_epi16(sum_lo, _mm_unpacklo_epi8(left, zero));
+                sum_hi = _mm_add_epi16(sum_hi, _mm_unpackhi_epi8(left, zero));
+                sum_lo = _mm_add_epi16(sum_lo, _mm_unpacklo_epi8(center, zero));
+                sum_hi = _mm_add_epi16(sum_hi, _mm_unpackhi_epi8(center, zero));
+                sum_lo = _mm_add_epi16(sum_lo, _mm_unpacklo_epi8(right, zero));
+                sum_hi = _mm_add_epi16(sum_hi, _mm_unpackhi_epi8(right, zero));
+            }
+            __m128i mean_lo = _mm_mulhi_epu16(_mm_add_epi16(sum_lo, bias), reciprocal);
+            __m128i mean_hi = _mm_mulhi_epu16(_mm_add_epi16(sum_hi, bias), reciprocal);
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(mean_lo, mean_hi));
+        }
+        // Scalar tail with the same rounding rule
+        for (; i < end; i++) {
+            int sum = 0;
+            for (int r = 0; r < 3; r++)
+                sum += rows[r][i - C] + rows[r][i] + rows[r][i + C];
+            dst[i] = static_cast<unsigned char>(((sum + 4) * RECIPROCAL_9) >> 16);
+        }
+    }
+}
+
+void box3_rows(const unsigned char* in, unsigned char* out, int width, int height,
+               int num_channels, int row_begin, int row_end) {
+    if (num_channels == 1)
+        box3_fixed_point_rows<1>(in, out, width, height, row_begin, row_end);
+    else
+        box3_fixed_point_rows<3>(in, out, width, height, row_begin, row_end);
+}
+
+} // namespace
+
+const SimdKernels sse41_kernels = {"sse4.1", rgb_to_gray, box3_rows};
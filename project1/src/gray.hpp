@@ -0,0 +1,49 @@
+//
+// Integer RGB to gray conversion shared by every PartA implementation
+//
+// Gray = (4899 * R + 9617 * G + 1868 * B + 8192) >> 14, the BT.601 weights
+// 0.299 / 0.587 / 0.114 in Q14 (they sum to exactly 1 << 14), rounded to
+// nearest. The scalar, threaded, MPI and SIMD implementations all compute
+// this exact expression, so they agree bit for bit.
+//
+
+#ifndef CSC4005_PROJECT_1_GRAY_HPP
+#define CSC4005_PROJECT_1_GRAY_HPP
+
+#include <cstddef>
+
+const int GRAY_SHIFT = 14;
+const int GRAY_WEIGHT_R = 4899;
+const int GRAY_WEIGHT_G = 9617;
+const int GRAY_WEIGHT_B = 1868;
+const int GRAY_ROUNDING = 1 << (GRAY_SHIFT - 1);
+
+// Pixels converted per iteration of rgb_to_gray_fixed
+const int GRAY_BLOCK = 32;
+
+// The functions are static: the SIMD variants include this header with
+// their own -m flags and must each keep a private copy
+
+static inline unsigned char rgb_to_gray_pixel(int r, int g, int b) {
+    return static_cast<unsigned char>(
+        (GRAY_WEIGHT_R * r + GRAY_WEIGHT_G * g + GRAY_WEIGHT_B * b + GRAY_ROUNDING) >> GRAY_SHIFT);
+}
+
+/**
+ * Convert num_pixels interleaved RGB pixels to gray, GRAY_BLOCK pixels per
+ * iteration (the block loop vectorizes with -fopenmp-simd / -fopenmp)
+ */
+static inline void rgb_to_gray_fixed(const unsigned char* rgb, unsigned char* gray, int num_pixels) {
+    int i = 0;
+    for (; i + GRAY_BLOCK <= num_pixels; i += GRAY_BLOCK) {
+        const unsigned char* p = rgb + static_cast<size_t>(i) * 3;
+        unsigned char* dst = gray + i;
+#pragma omp simd
+        for (int k = 0; k < GRAY_BLOCK; k++)
+            dst[k] = rgb_to_gray_pixel(p[k * 3], p[k * 3 + 1], p[k * 3 + 2]);
+    }
+    for (; i < num_pixels; i++)
+        gray[i] = rgb_to_gray_pixel(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+}
+
+#endif // CSC4005_PROJECT_1_GRAY_HPP
@@ -0,0 +1,551 @@
+//
+// Multi-threaded JPEG decoding and encoding through restart markers
+//
+
+#include "jpeg_parallel.hpp"
+#include "raw_image.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include <pthread.h>
+
+#if JPEG_LIB_VERSION >= 80 || defined(MEM_SRCDST_SUPPORTED)
+#define JPEG_PARALLEL_SUPPORTED 1
+#endif
+
+#ifdef JPEG_PARALLEL_SUPPORTED
+
+namespace {
+
+/**
+ * Layout of a single-scan sequential JPEG with restart markers
+ */
+struct RestartIndex {
+    std::vector<unsigned char> data;    // the whole file
+    size_t height_offset;               // image height field of the SOF segment
+    size_t scan_begin;                  // first byte of entropy-coded data
+    size_t scan_end;                    // marker ending the scan (EOI)
+    std::vector<size_t> segments;       // first byte of every restart interval
+    int height;
+    int restart_interval;               // MCUs per restart interval
+    int mcus_per_row;
+    int mcu_rows;
+    int mcu_height;
+    int band_mcu_rows;                  // smallest band of MCU rows bounded by markers
+    bool vertical_context;              // chroma upsampling reads the rows above and below
+};
+
+int read_be16(const std::vector<unsigned char>& data, size_t pos) {
+    return (data[pos] << 8) | data[pos + 1];
+}
+
+int gcd(int a, int b) {
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+bool read_file(const char* filepath, std::vector<unsigned char>* data) {
+    FILE* file = fopen(filepath, "rb");
+    if (file == NULL) return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data->resize(size > 0 ? size : 0);
+    bool ok = size > 0 && fread(data->data(), 1, size, file) == static_cast<size_t>(size);
+    fclose(file);
+    return ok;
+}
+
+/**
+ * Parse the headers and find every restart marker of the scan
+ * @return nullptr if the file can be decoded in strips, the reason otherwise
+ */
+const char* index_restart_markers(const char* filepath, RestartIndex* index) {
+    std::vector<unsigned char>& data = index->data;
+    if (!read_file(filepath, &data)) return "cannot read the file";
+    if (data.size() < 4 || data[0] != 0xFF || data[1] != 0xD8) return "not a JPEG file";
+
+    // Header segments up to the start of scan
+    size_t pos = 2;
+    int num_components = 0, scan_components = 0;
+    int width = 0, max_h = 1, max_v = 1;
+    int sampling_v[4] = {0, 0, 0, 0};
+    index->restart_interval = 0;
+    index->height = 0;
+    while (true) {
+        if (pos + 4 > data.size() || data[pos] != 0xFF) return "corrupt header";
+        while (pos < data.size() && data[pos] == 0xFF) pos++;
+        if (pos + 3 > data.size()) return "corrupt header";
+        int marker = data[pos++];
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) continue;  // no payload
+        if (marker == 0xD9) return "no scan";
+        int length = read_be16(data, pos);
+        if (length < 2 || pos + length > data.size()) return "corrupt header";
+        if (marker == 0xC0 || marker == 0xC1) {
+            index->height_offset = pos + 3;
+            index->height = read_be16(data, pos + 3);
+            width = read_be16(data, pos + 5);
+            num_components = data[pos + 7];
+            if (num_components < 1 || num_components > 4 || length < 8 + 3 * num_components)
+                return "unsupported components";
+            for (int c = 0; c < num_components; c++) {
+                int h = data[pos + 9 + 3 * c] >> 4;
+                int v = data[pos + 9 + 3 * c] & 15;
+                sampling_v[c] = v;
+                if (h > max_h) max_h = h;
+                if (v > max_v) max_v = v;
+            }
+        } else if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            return "progressive, lossless or arithmetic coded";
+        } else if (marker == 0xDD) {
+            index->restart_interval = read_be16(data, pos + 2);
+        } else if (marker == 0xDA) {
+            scan_components = data[pos + 2];
+            index->scan_begin = pos + length;
+            break;
+        }
+        pos += length;
+    }
+    if (num_components == 0) return "no frame header";
+    if (index->height == 0 || width == 0) return "image height defined by a DNL marker";
+    if (scan_components != num_components) return "several scans";
+    if (index->restart_interval == 0) return "no restart markers";
+
+    // MCU geometry: a single component scan codes one 8x8 block per MCU
+    int mcu_width = num_components == 1 ? 8 : 8 * max_h;
+    index->mcu_height = num_components == 1 ? 8 : 8 * max_v;
+    index->mcus_per_row = (width + mcu_width - 1) / mcu_width;
+    index->mcu_rows = (index->height + index->mcu_height - 1) / index->mcu_height;
+    index->vertical_context = false;
+    for (int c = 0; c < num_components && num_components > 1; c++)
+        if (sampling_v[c] != max_v) index->vertical_context = true;
+
+    // Restart markers of the entropy-coded data, 0xFF bytes of the data are
+    // stuffed with 0x00, any other marker ends the scan
+    index->segments.assign(1, index->scan_begin);
+    index->scan_end = 0;
+    pos = index->scan_begin;
+    while (pos + 1 < data.size()) {
+        const void* next = memchr(data.data() + pos, 0xFF, data.size() - pos - 1);
+        if (next == nullptr) break;
+        pos = static_cast<const unsigned char*>(next) - data.data();
+        int marker = data[pos + 1];
+        if (marker == 0x00 || marker == 0xFF) {
+            pos += marker == 0x00 ? 2 : 1;
+        } else if (marker >= 0xD0 && marker <= 0xD7) {
+            index->segments.push_back(pos + 2);
+            pos += 2;
+        } else {
+            if (marker != 0xD9) return "several scans";
+            index->scan_end = pos;
+            break;
+        }
+    }
+    if (index->scan_end == 0) return "truncated scan";
+    long total_mcus = static_cast<long>(index->mcus_per_row) * index->mcu_rows;
+    long intervals = (total_mcus + index->restart_interval - 1) / index->restart_interval;
+    if (static_cast<long>(index->segments.size()) != intervals) return "restart markers do not match DRI";
+
+    // Bands start on a marker when they are a multiple of this many rows
+    index->band_mcu_rows = index->restart_interval / gcd(index->restart_interval, index->mcus_per_row);
+    if (index->band_mcu_rows * 2 > index->mcu_rows) return "restart interval longer than half of the image";
+    return nullptr;
+}
+
+struct StripDecoder {
+    const RestartIndex* index;
+    int num_bands;                  // bands of band_mcu_rows MCU rows
+    int num_strips;
+    J_COLOR_SPACE out_color_space;
+    const CodecProfile* profile;
+    unsigned char* output;
+    size_t row_size;
+    std::atomic<int>* next_strip;
+    std::atomic<bool>* failed;      // set by any strip libjpeg rejected
+};
+
+/**
+ * Decode bands [band_begin, band_end) of the image into their rows of the
+ * output, through a stand-alone JPEG made of the original headers with the
+ * strip's height, its restart intervals renumbered from RST0, and EOI
+ * @return false if libjpeg failed on the strip
+ */
+bool decode_strip(const StripDecoder* decoder, int band_begin, int band_end) {
+    const RestartIndex& index = *decoder->index;
+    const std::vector<unsigned char>& data = index.data;
+    // One band of context on each side for vertically upsampled chroma
+    int first_band = band_begin > 0 && index.vertical_context ? band_begin - 1 : band_begin;
+    int last_band = band_end < decoder->num_bands && index.vertical_context ? band_end + 1 : band_end;
+    int first_mcu_row = first_band * index.band_mcu_rows;
+    int last_mcu_row = std::min(last_band * index.band_mcu_rows, index.mcu_rows);
+    int first_row = first_mcu_row * index.mcu_height;
+    int last_row = std::min(last_mcu_row * index.mcu_height, index.height);
+    int keep_begin = band_begin * index.band_mcu_rows * index.mcu_height;
+    int keep_end = std::min(band_end * index.band_mcu_rows * index.mcu_height, index.height);
+
+    long first_segment = static_cast<long>(first_mcu_row) * index.mcus_per_row / index.restart_interval;
+    long end_segment = (static_cast<long>(last_mcu_row) * index.mcus_per_row + index.restart_interval - 1) /
+                       index.restart_interval;
+    size_t data_begin = index.segments[first_segment];
+    size_t data_end = end_segment < static_cast<long>(index.segments.size()) ?
+                      index.segments[end_segment] - 2 : index.scan_end;
+
+    std::vector<unsigned char> strip;
+    strip.reserve(index.scan_begin + (data_end - data_begin) + 2);
+    strip.insert(strip.end(), data.begin(), data.begin() + index.scan_begin);
+    strip[index.height_offset] = static_cast<unsigned char>((last_row - first_row) >> 8);
+    strip[index.height_offset + 1] = static_cast<unsigned char>(last_row - first_row);
+    strip.insert(strip.end(), data.begin() + data_begin, data.begin() + data_end);
+    for (long s = first_segment + 1; s < end_segment; s++)
+        strip[index.scan_begin + (index.segments[s] - 1 - data_begin)] =
+            static_cast<unsigned char>(0xD0 + ((s - first_segment - 1) & 7));
+    strip.push_back(0xFF);
+    strip.push_back(0xD9);
+
+    struct jpeg_decompress_struct cinfo = jpeg_decompress_struct{};
+    JPEGErrorManager jerr;
+    cinfo.err = init_jpeg_error_manager(&jerr);
+    jpeg_create_decompress(&cinfo);
+    if (setjmp(jerr.escape)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    jpeg_mem_src(&cinfo, strip.data(), strip.size());
+    jpeg_read_header(&cinfo, TRUE);
+    if (decoder->out_color_space != JCS_UNKNOWN)
+        cinfo.out_color_space = decoder->out_color_space;
+    set_decode_profile(&cinfo, *decoder->profile);
+    jpeg_start_decompress(&cinfo);
+    std::vector<unsigned char> context_row(decoder->row_size);
+    for (int row = first_row; row < keep_end; row++) {
+        JSAMPROW row_pointer = row < keep_begin ? context_row.data() :
+                               decoder->output + static_cast<size_t>(row) * decoder->row_size;
+        jpeg_read_scanlines(&cinfo, &row_pointer, 1);
+    }
+    // The context band below is not needed past the strip's last row
+    jpeg_abort_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+void* decode_strips(void* arg) {
+    StripDecoder* decoder = reinterpret_cast<StripDecoder*>(arg);
+    for (int s = decoder->next_strip->fetch_add(1); s < decoder->num_strips;
+         s = decoder->next_strip->fetch_add(1)) {
+        int band_begin = static_cast<long>(decoder->num_bands) * s / decoder->num_strips;
+        int band_end = static_cast<long>(decoder->num_bands) * (s + 1) / decoder->num_strips;
+        if (!decode_strip(decoder, band_begin, band_end))
+            *decoder->failed = true;
+    }
+    return nullptr;
+}
+
+/**
+ * Output geometry of the file from its headers alone
+ * @return false if libjpeg rejects the headers
+ */
+bool read_output_geometry(const RestartIndex& index, J_COLOR_SPACE out_color_space, JPEGMeta* meta) {
+    struct jpeg_decompress_struct cinfo = jpeg_decompress_struct{};
+    JPEGErrorManager jerr;
+    cinfo.err = init_jpeg_error_manager(&jerr);
+    jpeg_create_decompress(&cinfo);
+    if (setjmp(jerr.escape)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    jpeg_mem_src(&cinfo, index.data.data(), index.data.size());
+    jpeg_read_header(&cinfo, TRUE);
+    if (out_color_space != JCS_UNKNOWN)
+        cinfo.out_color_space = out_color_space;
+    jpeg_calc_output_dimensions(&cinfo);
+    *meta = {NULL, static_cast<int>(cinfo.output_width), static_cast<int>(cinfo.output_height),
+             cinfo.output_components, cinfo.out_color_space};
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+} // namespace
+
+#endif // JPEG_PARALLEL_SUPPORTED
+
+JPEGMeta read_from_jpeg_parallel(const char* filepath, int num_threads, ParallelDecodeInfo* info,
+                                 J_COLOR_SPACE out_color_space, const CodecProfile& profile) {
+#ifdef JPEG_PARALLEL_SUPPORTED
+    RestartIndex index;
+    const char* fallback = num_threads > 1 ? index_restart_markers(filepath, &index) : "one thread";
+    if (fallback == nullptr) {
+        JPEGMeta meta;
+        if (!read_output_geometry(index, out_color_space, &meta)) {
+            if (info != nullptr) *info = {0, "unreadable headers"};
+            return {NULL, 0, 0, 0, JCS_UNKNOWN};
+        }
+        int num_bands = (index.mcu_rows + index.band_mcu_rows - 1) / index.band_mcu_rows;
+        std::atomic<int> next_strip(0);
+        std::atomic<bool> failed(false);
+        meta.buffer = new unsigned char[meta.width * meta.height * meta.num_channels];
+        StripDecoder decoder{&index, num_bands, std::min(num_bands, num_threads), out_color_space, &profile,
+                             meta.buffer, static_cast<size_t>(meta.width) * meta.num_channels, &next_strip,
+                             &failed};
+        std::vector<pthread_t> threads(decoder.num_strips - 1);
+        for (auto& thread : threads)
+            pthread_create(&thread, nullptr, decode_strips, &decoder);
+        decode_strips(&decoder);
+        for (auto& thread : threads)
+            pthread_join(thread, nullptr);
+        if (info != nullptr) *info = {decoder.num_strips, nullptr};
+        if (failed) {
+            // libjpeg printed why; the image is only partly decoded
+            delete[] meta.buffer;
+            return {NULL, 0, 0, 0, JCS_UNKNOWN};
+        }
+        return meta;
+    }
+#else
+    const char* fallback = "libjpeg without jpeg_mem_src";
+#endif
+    if (info != nullptr) *info = {0, fallback};
+    return read_from_jpeg(filepath, out_color_space, profile);
+}
+
+JPEGMeta read_from_jpeg_reported(const char* filepath, int num_threads, const CodecProfile& profile) {
+    ParallelDecodeInfo info;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    JPEGMeta jpeg;
+    if (is_raw_image_path(filepath)) {
+        // Nothing to decode
+        jpeg = read_image(filepath);
+        info = {0, "raw image"};
+    } else {
+        jpeg = read_from_jpeg_parallel(filepath, num_threads, &info, JCS_UNKNOWN, profile);
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::cout << "Decode Time: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count()
+              << " milliseconds, ";
+    if (info.strips > 0) std::cout << info.strips << " strips in parallel\n";
+    else std::cout << "serial (" << info.fallback << ")\n";
+    return jpeg;
+}
+
+#ifdef JPEG_PARALLEL_SUPPORTED
+
+namespace {
+
+// Same settings as open_jpeg_writer, plus a restart marker every MCU row
+void set_strip_encoder(jpeg_compress_struct* cinfo, const JPEGMeta& data, int height,
+                       const CodecProfile& profile) {
+    cinfo->image_width = data.width;
+    cinfo->image_height = height;
+    cinfo->input_components = data.num_channels;
+    cinfo->in_color_space = data.color_space;
+    jpeg_set_defaults(cinfo);
+    set_encode_profile(cinfo, profile);
+    // Standard Huffman tables whatever the profile, so that every strip
+    // codes with the tables of the single header that is kept
+    cinfo->optimize_coding = FALSE;
+    cinfo->restart_in_rows = 1;
+}
+
+struct StripEncoder {
+    const JPEGMeta* data;
+    const CodecProfile* profile;
+    int strip_rows;                 // multiple of the MCU height
+    int num_strips;
+    std::vector<unsigned char*> buffers;
+    std::vector<unsigned long> sizes;
+    std::vector<char> failed;       // per strip, set if libjpeg rejected it
+    std::atomic<int>* next_strip;
+};
+
+/**
+ * Encode strip s into its own memory buffer
+ * @return false if libjpeg failed on the strip
+ */
+bool encode_strip(StripEncoder* encoder, int s) {
+    const JPEGMeta& data = *encoder->data;
+    const size_t row_size = static_cast<size_t>(data.width) * data.num_channels;
+    int row_begin = s * encoder->strip_rows;
+    int row_end = std::min(row_begin + encoder->strip_rows, data.height);
+    struct jpeg_compress_struct cinfo = jpeg_compress_struct{};
+    JPEGErrorManager jerr;
+    cinfo.err = init_jpeg_error_manager(&jerr);
+    jpeg_create_compress(&cinfo);
+    encoder->buffers[s] = nullptr;
+    encoder->sizes[s] = 0;
+    if (setjmp(jerr.escape)) {
+        jpeg_destroy_compress(&cinfo);
+        // Only set by a finished compression; a grown buffer may already
+        // have been freed by libjpeg, so it is not freed again
+        encoder->buffers[s] = nullptr;
+        return false;
+    }
+    jpeg_mem_dest(&cinfo, &encoder->buffers[s], &encoder->sizes[s]);
+    set_strip_encoder(&cinfo, data, row_end - row_begin, *encoder->profile);
+    jpeg_start_compress(&cinfo, TRUE);
+    for (int row = row_begin; row < row_end; row++) {
+        JSAMPROW row_pointer = data.buffer + row * row_size;
+        jpeg_write_scanlines(&cinfo, &row_pointer, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    return true;
+}
+
+void* encode_strips(void* arg) {
+    StripEncoder* encoder = reinterpret_cast<StripEncoder*>(arg);
+    for (int s = encoder->next_strip->fetch_add(1); s < encoder->num_strips;
+         s = encoder->next_strip->fetch_add(1))
+        encoder->failed[s] = !encode_strip(encoder, s);
+    return nullptr;
+}
+
+/**
+ * MCU height of the encoder's default sampling for data
+ * @return false if libjpeg rejects the image parameters
+ */
+bool encoder_mcu_height(const JPEGMeta& data, const CodecProfile& profile, int* mcu_height) {
+    struct jpeg_compress_struct cinfo = jpeg_compress_struct{};
+    JPEGErrorManager jerr;
+    cinfo.err = init_jpeg_error_manager(&jerr);
+    jpeg_create_compress(&cinfo);
+    if (setjmp(jerr.escape)) {
+        jpeg_destroy_compress(&cinfo);
+        return false;
+    }
+    set_strip_encoder(&cinfo, data, data.height, profile);
+    *mcu_height = DCTSIZE;
+    for (int c = 0; c < cinfo.num_components && cinfo.num_components > 1; c++)
+        *mcu_height = std::max(*mcu_height, cinfo.comp_info[c].v_samp_factor * DCTSIZE);
+    jpeg_destroy_compress(&cinfo);
+    return true;
+}
+
+/**
+ * Offsets of the SOF height field and of the first entropy-coded byte in
+ * a JPEG written by libjpeg
+ */
+bool find_scan(const unsigned char* jpeg, unsigned long size, size_t* height_offset, size_t* scan_begin) {
+    size_t pos = 2;
+    *height_offset = 0;
+    while (pos + 4 <= size && jpeg[pos] == 0xFF) {
+        int marker = jpeg[pos + 1];
+        size_t length = (jpeg[pos + 2] << 8) | jpeg[pos + 3];
+        if (marker == 0xC0 || marker == 0xC1) *height_offset = pos + 5;
+        if (marker == 0xDA) {
+            *scan_begin = pos + 2 + length;
+            return *height_offset != 0;
+        }
+        pos += 2 + length;
+    }
+    return false;
+}
+
+/**
+ * Append a strip's entropy-coded data, its restart markers renumbered to
+ * follow on from the restart intervals already written
+ */
+void append_intervals(std::vector<unsigned char>* out, const unsigned char* data, size_t size, int first_interval) {
+    size_t begin = out->size();
+    out->insert(out->end(), data, data + size);
+    unsigned char* bytes = out->data();
+    int interval = first_interval;
+    for (size_t pos = begin; pos + 1 < out->size(); pos += 2) {
+        void* next = memchr(bytes + pos, 0xFF, out->size() - pos - 1);
+        if (next == nullptr) break;
+        pos = static_cast<unsigned char*>(next) - bytes;
+        // Anything but a marker is the stuffed 0x00 of a 0xFF data byte
+        if (bytes[pos + 1] >= 0xD0 && bytes[pos + 1] <= 0xD7)
+            bytes[pos + 1] = static_cast<unsigned char>(0xD0 + (interval++ & 7));
+    }
+}
+
+} // namespace
+
+#endif // JPEG_PARALLEL_SUPPORTED
+
+int write_to_jpeg_parallel(const JPEGMeta& data, const char* filepath, int num_threads,
+                           const CodecProfile& profile) {
+#ifdef JPEG_PARALLEL_SUPPORTED
+    int mcu_height;
+    if (!encoder_mcu_height(data, profile, &mcu_height))
+        return -1;
+
+    int mcu_rows = (data.height + mcu_height - 1) / mcu_height;
+    int num_strips = std::min(num_threads, mcu_rows);
+    if (num_strips > 1) {
+        std::atomic<int> next_strip(0);
+        StripEncoder encoder{&data, &profile, (mcu_rows + num_strips - 1) / num_strips * mcu_height, 0,
+                             {}, {}, {}, &next_strip};
+        encoder.num_strips = (data.height + encoder.strip_rows - 1) / encoder.strip_rows;
+        encoder.buffers.resize(encoder.num_strips);
+        encoder.sizes.resize(encoder.num_strips);
+        encoder.failed.resize(encoder.num_strips);
+        std::vector<pthread_t> threads(std::min(num_threads, encoder.num_strips) - 1);
+        for (auto& thread : threads)
+            pthread_create(&thread, nullptr, encode_strips, &encoder);
+        encode_strips(&encoder);
+        for (auto& thread : threads)
+            pthread_join(thread, nullptr);
+
+        // Headers of the first strip with the full height, then the
+        // intervals of every strip, an RST marker between strips, and EOI
+        std::vector<unsigned char> jpeg;
+        bool ok = true;
+        int interval = 0;
+        for (int s = 0; s < encoder.num_strips && ok; s++) {
+            if (encoder.failed[s]) {
+                ok = false;
+                break;
+            }
+            size_t height_offset, scan_begin;
+            ok = find_scan(encoder.buffers[s], encoder.sizes[s], &height_offset, &scan_begin);
+            if (!ok) break;
+            if (s == 0) {
+                jpeg.insert(jpeg.end(), encoder.buffers[s], encoder.buffers[s] + scan_begin);
+                jpeg[height_offset] = static_cast<unsigned char>(data.height >> 8);
+                jpeg[height_offset + 1] = static_cast<unsigned char>(data.height);
+            } else {
+                jpeg.push_back(0xFF);
+                jpeg.push_back(static_cast<unsigned char>(0xD0 + (interval++ & 7)));
+            }
+            size_t scan_size = encoder.sizes[s] - 2 - scan_begin;     // up to EOI
+            append_intervals(&jpeg, encoder.buffers[s] + scan_begin, scan_size, interval);
+            interval += encoder.strip_rows / mcu_height - 1;
+        }
+        for (int s = 0; s < encoder.num_strips; s++)
+            free(encoder.buffers[s]);
+        if (!ok) return -1;
+        jpeg.push_back(0xFF);
+        jpeg.push_back(0xD9);
+
+        FILE* file = fopen(filepath, "wb");
+        if (file == NULL) return -1;
+        bool written = fwrite(jpeg.data(), 1, jpeg.size(), file) == jpeg.size();
+        if (fclose(file) == 0 && written) return 0;
+        // No partial file left behind, like write_to_jpeg
+        remove(filepath);
+        return -1;
+    }
+#endif
+    return write_to_jpeg(data, filepath, profile);
+}
+
+int write_to_jpeg_reported(const JPEGMeta& data, const char* filepath, int num_threads,
+                           const CodecProfile& profile) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    int result = is_raw_image_path(filepath) ? write_image(data, filepath)
+                                             : write_to_jpeg_parallel(data, filepath, num_threads, profile);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::cout << "Encode Time: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count()
+              << " milliseconds\n";
+    return result;
+}
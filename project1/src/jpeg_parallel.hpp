@@ -0,0 +1,70 @@
+//
+// Multi-threaded JPEG decoding and encoding through restart markers
+//
+// A restart marker (RSTn, every DRI minimum coded units) resets the
+// entropy decoder, so the data between two markers can be decoded without
+// the rest of the scan. When the markers fall on MCU row boundaries, a band
+// of MCU rows is itself a valid JPEG once given the original headers with a
+// smaller height, and the bands are decoded on separate threads straight
+// into the shared output image.
+//
+// Encoding goes the other way: strips of MCU rows are encoded separately,
+// each with a marker per MCU row, and their entropy-coded data is joined
+// under a single header.
+//
+
+#ifndef CSC4005_PROJECT_1_JPEG_PARALLEL_HPP
+#define CSC4005_PROJECT_1_JPEG_PARALLEL_HPP
+
+#include "utils.hpp"
+
+struct ParallelDecodeInfo {
+    int strips;             // strips decoded in parallel, 0 after a serial fallback
+    const char* fallback;   // why the file was decoded serially, nullptr otherwise
+};
+
+/**
+ * Read a JPEG file like read_from_jpeg, decoding strips of MCU rows on
+ * num_threads threads when the file has restart markers at MCU row
+ * boundaries. Baseline / extended sequential Huffman files with one
+ * interleaved scan qualify; anything else (no DRI, progressive, several
+ * scans, markers not aligned with the rows) falls back to read_from_jpeg.
+ * The result is identical to read_from_jpeg: where chroma is vertically
+ * subsampled, strips are decoded with one restart-aligned band of overlap
+ * on each side, so the upsampler sees the same neighbouring rows.
+ * Like read_from_jpeg, returns a NULL buffer if libjpeg rejects any strip.
+ */
+JPEGMeta read_from_jpeg_parallel(const char* filepath, int num_threads, ParallelDecodeInfo* info,
+                                 J_COLOR_SPACE out_color_space = JCS_UNKNOWN,
+                                 const CodecProfile& profile = CodecProfile());
+
+/**
+ * read_from_jpeg_parallel for the --parallel-decode switch of the PartB
+ * executables: also prints the decode time and how the file was decoded.
+ * .raw images are read with read_image.
+ */
+JPEGMeta read_from_jpeg_reported(const char* filepath, int num_threads,
+                                 const CodecProfile& profile = CodecProfile());
+
+/**
+ * Write a JPEG file like write_to_jpeg, encoding horizontal
+ * strips of whole MCU rows on num_threads threads. Every strip is encoded
+ * with a restart marker per MCU row, so the strips' entropy-coded data can
+ * be joined under the first strip's header into one baseline JPEG, the same
+ * file a single encoder with that restart interval would write. Such files
+ * can in turn be decoded by read_from_jpeg_parallel. The profile's
+ * optimize_coding is ignored, all strips must share the standard tables.
+ * @return 0 on success, -1 on error
+ */
+int write_to_jpeg_parallel(const JPEGMeta& data, const char* filepath, int num_threads,
+                           const CodecProfile& profile = CodecProfile());
+
+/**
+ * write_to_jpeg_parallel for the --parallel-encode switch of the PartB
+ * executables: also prints the encode time. .raw images are written with
+ * write_image.
+ */
+int write_to_jpeg_reported(const JPEGMeta& data, const char* filepath, int num_threads,
+                           const CodecProfile& profile = CodecProfile());
+
+#endif // CSC4005_PROJECT_1_JPEG_PARALLEL_HPP
@@ -0,0 +1,133 @@
+//
+// Overlapped, chunked gathering of the results for the MPI implementations
+//
+// Every worker computes its band in chunks of a few rows and sends each
+// chunk with MPI_Isend as soon as it is done. The master posts an MPI_Irecv
+// for every chunk of every worker, straight into its place in the output
+// image, before it computes its own band, so chunks land while it computes
+// and a slow worker no longer holds up the ones after it.
+//
+
+#ifndef CSC4005_PROJECT_1_MPI_GATHER_HPP
+#define CSC4005_PROJECT_1_MPI_GATHER_HPP
+
+#include <algorithm>
+#include <vector>
+
+#include <mpi.h>
+
+#include "phases.hpp"
+#include "perf_counters.hpp"
+
+#define TAG_CHUNK 2
+
+/**
+ * Post the master's receives: band [cuts[r], cuts[r + 1]) of every rank r
+ * but the root, in chunks of chunk_units units of unit_size bytes, into
+ * image. Matching messages from one sender arrive in order, so chunk i of
+ * a rank lands in the i-th receive posted for it.
+ * @return requests to complete with MPI_Waitall
+ */
+inline std::vector<MPI_Request> post_chunk_receives(unsigned char* image, const std::vector<int>& cuts,
+                                                    int unit_size, int chunk_units, int root, MPI_Comm comm) {
+    int size;
+    MPI_Comm_size(comm, &size);
+    std::vector<MPI_Request> requests;
+    for (int r = 0; r < size; r++) {
+        if (r == root) continue;
+        for (int begin = cuts[r]; begin < cuts[r + 1]; begin += chunk_units) {
+            int count = cuts[r + 1] - begin < chunk_units ? cuts[r + 1] - begin : chunk_units;
+            requests.push_back(MPI_REQUEST_NULL);
+            MPI_Irecv(image + static_cast<size_t>(begin) * unit_size, count * unit_size, MPI_UNSIGNED_CHAR,
+                      r, TAG_CHUNK, comm, &requests.back());
+        }
+    }
+    return requests;
+}
+
+/**
+ * Worker side: compute(begin, end) fills units [begin, end) of the band in
+ * `band`, chunk_units at a time, and every chunk is sent to the root as soon
+ * as it is computed; returns once all sends have completed.
+ */
+template <typename Compute>
+void compute_and_send_chunks(unsigned char* band, int num_units, int unit_size, int chunk_units,
+                             int root, MPI_Comm comm, Compute compute) {
+    std::vector<MPI_Request> requests;
+    for (int begin = 0; begin < num_units; begin += chunk_units) {
+        int end = num_units - begin < chunk_units ? num_units : begin + chunk_units;
+        compute(begin, end);
+        requests.push_back(MPI_REQUEST_NULL);
+        MPI_Isend(band + static_cast<size_t>(begin) * unit_size, (end - begin) * unit_size, MPI_UNSIGNED_CHAR,
+                  root, TAG_CHUNK, comm, &requests.back());
+    }
+    PhaseTimer wait_timer(Phase::Communicate);
+    MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+}
+
+/**
+ * Collective: send every rank's phase records to the root, which appends
+ * them to its log's imported records (--phases)
+ */
+inline void gather_phase_log(int root, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    // Five doubles per record: phase, rank, thread, ms, calls
+    std::vector<double> local;
+    for (const PhaseRecord& record : phase_log().records())
+        local.insert(local.end(), {static_cast<double>(record.phase), static_cast<double>(record.rank),
+                                   static_cast<double>(record.thread), record.ms,
+                                   static_cast<double>(record.calls)});
+    int count = static_cast<int>(local.size());
+    std::vector<int> counts(size), displacements(size, 0);
+    MPI_Gather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, root, comm);
+    for (int r = 1; r < size; r++)
+        displacements[r] = displacements[r - 1] + counts[r - 1];
+    std::vector<double> all(rank == root ? displacements[size - 1] + counts[size - 1] : 0);
+    MPI_Gatherv(local.data(), count, MPI_DOUBLE, all.data(), counts.data(), displacements.data(), MPI_DOUBLE,
+                root, comm);
+    if (rank != root) return;
+    for (int r = 0; r < size; r++) {
+        if (r == root) continue;
+        for (int i = displacements[r]; i < displacements[r] + counts[r]; i += 5)
+            phase_log().imported.push_back({static_cast<int>(all[i]), static_cast<int>(all[i + 1]),
+                                            static_cast<int>(all[i + 2]), all[i + 3], static_cast<long>(all[i + 4])});
+    }
+}
+
+/**
+ * Collective: send every rank's per-thread counts to the root, which
+ * appends them to its counter log's imported records (--counters)
+ */
+inline void gather_perf_counters(int root, MPI_Comm comm) {
+    const int fields = 2 + NUM_PERF_EVENTS;    // rank, thread, values
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    std::vector<double> local;
+    for (const PerfRecord& record : perf_counter_log().records()) {
+        local.push_back(record.rank);
+        local.push_back(record.thread);
+        local.insert(local.end(), record.values, record.values + NUM_PERF_EVENTS);
+    }
+    int count = static_cast<int>(local.size());
+    std::vector<int> counts(size), displacements(size, 0);
+    MPI_Gather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, root, comm);
+    for (int r = 1; r < size; r++)
+        displacements[r] = displacements[r - 1] + counts[r - 1];
+    std::vector<double> all(rank == root ? displacements[size - 1] + counts[size - 1] : 0);
+    MPI_Gatherv(local.data(), count, MPI_DOUBLE, all.data(), counts.data(), displacements.data(), MPI_DOUBLE,
+                root, comm);
+    if (rank != root) return;
+    for (int r = 0; r < size; r++) {
+        if (r == root) continue;
+        for (int i = displacements[r]; i < displacements[r] + counts[r]; i += fields) {
+            PerfRecord record{static_cast<int>(all[i]), static_cast<int>(all[i + 1]), {}};
+            std::copy(&all[i + 2], &all[i + 2] + NUM_PERF_EVENTS, record.values);
+            perf_counter_log().imported.push_back(record);
+        }
+    }
+}
+
+#endif // CSC4005_PROJECT_1_MPI_GATHER_HPP
@@ -0,0 +1,94 @@
+//
+// Decode-once distribution of an image for the MPI implementations (--scatter)
+//
+// Only the master decodes the JPEG. The other ranks receive the header with
+// MPI_Bcast and just their band of the image (plus the halo rows a filter
+// needs) with MPI_Scatterv, so each of them holds O(image / N) bytes instead
+// of a full decoded copy.
+//
+
+#ifndef CSC4005_PROJECT_1_MPI_SCATTER_HPP
+#define CSC4005_PROJECT_1_MPI_SCATTER_HPP
+
+#include <vector>
+
+#include <mpi.h>
+
+#include "utils.hpp"
+
+#define TAG_HALO 1
+
+// Send the master's image header (buffer excluded) to every rank, width 0
+// tells the others that the master failed to decode the image
+inline void broadcast_jpeg_meta(JPEGMeta* jpeg, int root, MPI_Comm comm) {
+    int meta[4] = {jpeg->width, jpeg->height, jpeg->num_channels, static_cast<int>(jpeg->color_space)};
+    MPI_Bcast(meta, 4, MPI_INT, root, comm);
+    jpeg->width = meta[0];
+    jpeg->height = meta[1];
+    jpeg->num_channels = meta[2];
+    jpeg->color_space = static_cast<J_COLOR_SPACE>(meta[3]);
+}
+
+/**
+ * Hand rank r the units [cuts[r], cuts[r + 1]) of the master's image, a
+ * unit being unit_size contiguous bytes (a pixel, or a row of pixels), plus
+ * up to `halo` units on each side. The bands go out with one MPI_Scatterv
+ * of a unit datatype; the halos overlap the neighbouring bands, which a
+ * scatter must not read twice from the root buffer, so the neighbours swap
+ * them afterwards with MPI_Sendrecv. Every band needs at least `halo` units.
+ * @param image whole image on the root, ignored on the other ranks
+ * @param first_unit set to the index of the first unit returned
+ * @param num_units set to the number of units returned, band plus halos
+ * @return the rank's units: a new[] buffer, or a pointer into image on the root
+ */
+inline unsigned char* scatter_bands(unsigned char* image, const std::vector<int>& cuts, int unit_size,
+                                    int halo, int root, MPI_Comm comm, int* first_unit, int* num_units) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    int total_units = cuts[size];
+    int band_begin = cuts[rank];
+    int band_end = cuts[rank + 1];
+    int halo_above = band_begin < halo ? band_begin : halo;
+    int halo_below = total_units - band_end < halo ? total_units - band_end : halo;
+    *first_unit = band_begin - halo_above;
+    *num_units = halo_above + (band_end - band_begin) + halo_below;
+
+    MPI_Datatype unit_type;
+    MPI_Type_contiguous(unit_size, MPI_UNSIGNED_CHAR, &unit_type);
+    MPI_Type_commit(&unit_type);
+
+    std::vector<int> counts(size), displacements(size);
+    for (int r = 0; r < size; r++) {
+        counts[r] = cuts[r + 1] - cuts[r];
+        displacements[r] = cuts[r];
+    }
+    unsigned char* local;
+    if (rank == root) {
+        local = image + static_cast<size_t>(*first_unit) * unit_size;
+        MPI_Scatterv(image, counts.data(), displacements.data(), unit_type,
+                     MPI_IN_PLACE, 0, unit_type, root, comm);
+    } else {
+        local = new unsigned char[static_cast<size_t>(*num_units) * unit_size];
+        MPI_Scatterv(nullptr, nullptr, nullptr, unit_type,
+                     local + static_cast<size_t>(halo_above) * unit_size, counts[rank], unit_type, root, comm);
+    }
+
+    if (halo > 0) {
+        int above = rank > 0 ? rank - 1 : MPI_PROC_NULL;
+        int below = rank < size - 1 ? rank + 1 : MPI_PROC_NULL;
+        unsigned char* band = local + static_cast<size_t>(halo_above) * unit_size;
+        unsigned char* band_last = local + static_cast<size_t>(halo_above + band_end - band_begin - halo) * unit_size;
+        unsigned char* after_band = local + static_cast<size_t>(halo_above + band_end - band_begin) * unit_size;
+        // The last units of a band are the halo above the next band, its
+        // first units the halo below the previous one
+        MPI_Sendrecv(band_last, halo, unit_type, below, TAG_HALO,
+                     local, halo_above, unit_type, above, TAG_HALO, comm, MPI_STATUS_IGNORE);
+        MPI_Sendrecv(band, halo, unit_type, above, TAG_HALO,
+                     after_band, halo_below, unit_type, below, TAG_HALO, comm, MPI_STATUS_IGNORE);
+    }
+    MPI_Type_free(&unit_type);
+    return local;
+}
+
+#endif // CSC4005_PROJECT_1_MPI_SCATTER_HPP
@@ -0,0 +1,65 @@
+//
+// NUMA placement helpers of the shared-memory PartB backends (--numa)
+//
+// Linux places a page on the node of the thread that first writes it.
+// read_from_jpeg decodes on the main thread, so the whole image lands on
+// one node. In NUMA mode every worker is pinned to a CPU, then copies (or
+// deinterleaves) its own band of rows into a fresh buffer and is the first
+// to write its band of the output, so the filter only reads and writes
+// local memory, apart from the K/2 halo rows of the neighbouring bands.
+//
+
+#ifndef CSC4005_PROJECT_1_NUMA_HPP
+#define CSC4005_PROJECT_1_NUMA_HPP
+
+#include <cstdio>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+// CPUs this process may run on (its affinity mask), in ascending order
+inline std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+    if (cpus.empty()) cpus.push_back(0);
+    return cpus;
+}
+
+/**
+ * CPU of worker `index` out of `count`: workers are spread evenly over the
+ * allowed CPUs in order, so consecutive bands sit on consecutive CPUs and
+ * thus mostly on the same node
+ */
+inline int worker_cpu(const std::vector<int>& cpus, int index, int count) {
+    return cpus[static_cast<long>(index) * cpus.size() / count];
+}
+
+// Pin the calling thread to one CPU, it migrates there before returning
+inline bool pin_current_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// Number of memory nodes, 1 when sysfs does not list them
+inline int numa_node_count() {
+    int count = 0;
+    char path[64];
+    for (int node = 0; node < 1024; node++) {
+        std::snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE* file = std::fopen(path, "r");
+        if (file == nullptr) break;
+        std::fclose(file);
+        count++;
+    }
+    return count > 0 ? count : 1;
+}
+
+#endif // CSC4005_PROJECT_1_NUMA_HPP
@@ -0,0 +1,56 @@
+//
+// Command line options shared by all executables
+//
+// Positional arguments keep their original meaning (input / output path,
+// number of threads, ...), optional switches are given as `--key=value`
+//
+
+#ifndef CSC4005_PROJECT_1_OPTIONS_HPP
+#define CSC4005_PROJECT_1_OPTIONS_HPP
+
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Positional arguments and `--key=value` switches parsed from argv.
+ * A switch given without a value (`--key`) is stored as "1".
+ */
+struct Options {
+    std::vector<const char*> positional;
+    std::map<std::string, std::string> flags;
+
+    bool has(const std::string& key) const {
+        return flags.count(key) != 0;
+    }
+
+    std::string get(const std::string& key, const std::string& fallback) const {
+        auto it = flags.find(key);
+        return it == flags.end() ? fallback : it->second;
+    }
+
+    int get_int(const std::string& key, int fallback) const {
+        auto it = flags.find(key);
+        return it == flags.end() ? fallback : std::atoi(it->second.c_str());
+    }
+};
+
+inline Options parse_options(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+            size_t eq = arg.find('=');
+            if (eq == std::string::npos)
+                options.flags[arg.substr(2)] = "1";
+            else
+                options.flags[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+        } else {
+            options.positional.push_back(argv[i]);
+        }
+    }
+    return options;
+}
+
+#endif // CSC4005_PROJECT_1_OPTIONS_HPP
@@ -0,0 +1,271 @@
+//
+// Hardware performance counters of the timed compute loops (--counters)
+//
+// Every thread that enters a PerfScope opens, once, its own group of four
+// counters with perf_event_open: CPU cycles (the group leader),
+// instructions, last level cache read misses and dTLB read misses, user
+// space only so that the default perf_event_paranoid setting allows them.
+// The group is reset and enabled when a scope starts and disabled and read
+// in one go when it ends, so the four counts always cover the same
+// instructions; if the kernel had to multiplex the group, the counts are
+// scaled by time enabled / time running.
+//
+// print_perf_counters reports IPC and the memory traffic the LLC misses
+// imply (one cache line each) per pixel of the image, overall and per
+// thread. Counters an environment lacks (no PMU in a VM, a cache event the
+// CPU does not expose) are reported as unavailable rather than failing
+// the run. The MPI executables merge every rank's counts into the
+// master's with gather_perf_counters (mpi_gather.hpp).
+//
+
+#ifndef CSC4005_PROJECT_1_PERF_COUNTERS_HPP
+#define CSC4005_PROJECT_1_PERF_COUNTERS_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+enum PerfEvent { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_LLC_MISSES, PERF_DTLB_MISSES };
+
+const int NUM_PERF_EVENTS = 4;
+
+// Bytes moved per LLC miss
+const int CACHE_LINE_SIZE = 64;
+
+inline const char* perf_event_name(int event) {
+    static const char* names[NUM_PERF_EVENTS] = {"cycles", "instructions", "LLC misses", "dTLB misses"};
+    return names[event];
+}
+
+// Counts of one thread, -1 for an event that could not be opened
+struct PerfRecord {
+    int rank;
+    int thread;
+    double values[NUM_PERF_EVENTS];
+};
+
+namespace perf_detail {
+
+inline int open_event(uint32_t type, uint64_t config, int group_fd) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group_fd < 0;   // members follow the leader
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+inline uint64_t cache_miss_config(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+// Counter group of one thread
+struct Group {
+    int leader;                     // -1 if not even the leader opened
+    int slots[NUM_PERF_EVENTS];     // position in the group's read, -1 if missing
+    int num_members;
+    double totals[NUM_PERF_EVENTS];
+};
+
+} // namespace perf_detail
+
+class PerfCounterLog {
+public:
+    PerfCounterLog() : enabled(false), rank(0), open_errno(0) {
+        pthread_mutex_init(&mutex, nullptr);
+    }
+
+    ~PerfCounterLog() {
+        pthread_mutex_destroy(&mutex);
+    }
+
+    PerfCounterLog(const PerfCounterLog&) = delete;
+    PerfCounterLog& operator=(const PerfCounterLog&) = delete;
+
+    bool enabled;
+    int rank;
+    int open_errno;                     // why a leader failed to open, 0 if none did
+    std::vector<PerfRecord> imported;   // other ranks', see gather_perf_counters
+
+    // Counter group of the calling thread, opened on its first call
+    perf_detail::Group* thread_group() {
+        static thread_local perf_detail::Group* group = nullptr;
+        if (group == nullptr) {
+            pthread_mutex_lock(&mutex);
+            groups.push_back(perf_detail::Group());
+            group = &groups.back();
+            open_group(group);
+            pthread_mutex_unlock(&mutex);
+        }
+        return group;
+    }
+
+    /**
+     * Counts of every thread of this rank, then the imported ones. Call
+     * once the measured threads are done.
+     */
+    std::vector<PerfRecord> records() {
+        std::vector<PerfRecord> result;
+        pthread_mutex_lock(&mutex);
+        for (size_t t = 0; t < groups.size(); t++) {
+            PerfRecord record{rank, static_cast<int>(t), {}};
+            for (int e = 0; e < NUM_PERF_EVENTS; e++)
+                record.values[e] = groups[t].slots[e] < 0 ? -1 : groups[t].totals[e];
+            result.push_back(record);
+        }
+        pthread_mutex_unlock(&mutex);
+        result.insert(result.end(), imported.begin(), imported.end());
+        return result;
+    }
+
+private:
+    void open_group(perf_detail::Group* group) {
+        using namespace perf_detail;
+        const uint32_t types[NUM_PERF_EVENTS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+                                                 PERF_TYPE_HW_CACHE};
+        const uint64_t configs[NUM_PERF_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                   cache_miss_config(PERF_COUNT_HW_CACHE_LL),
+                                                   cache_miss_config(PERF_COUNT_HW_CACHE_DTLB)};
+        group->leader = -1;
+        group->num_members = 0;
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+            group->slots[e] = -1;
+            group->totals[e] = 0;
+        }
+        group->leader = open_event(types[0], configs[0], -1);
+        if (group->leader < 0) {
+            open_errno = errno;
+            return;
+        }
+        group->slots[0] = group->num_members++;
+        for (int e = 1; e < NUM_PERF_EVENTS; e++) {
+            // Members stay open for the life of the thread, read through the leader
+            if (open_event(types[e], configs[e], group->leader) >= 0)
+                group->slots[e] = group->num_members++;
+        }
+    }
+
+    std::deque<perf_detail::Group> groups;  // stable addresses as threads register
+    pthread_mutex_t mutex;
+};
+
+inline PerfCounterLog& perf_counter_log() {
+    static PerfCounterLog log;
+    return log;
+}
+
+// Called by the main thread before any scope of the run
+inline void enable_perf_counters(int rank = 0) {
+    PerfCounterLog& log = perf_counter_log();
+    log.rank = rank;
+    log.enabled = true;
+}
+
+/**
+ * Count the calling thread's events from construction to destruction (or
+ * stop()). Without enable_perf_counters() it costs one test of a flag.
+ */
+class PerfScope {
+public:
+    PerfScope() : group(nullptr) {
+        PerfCounterLog& log = perf_counter_log();
+        if (!log.enabled) return;
+        group = log.thread_group();
+        if (group->leader < 0) {
+            group = nullptr;
+            return;
+        }
+        ioctl(group->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(group->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    ~PerfScope() {
+        stop();
+    }
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+    void stop() {
+        if (group == nullptr) return;
+        ioctl(group->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        // nr, time enabled, time running, one value per member
+        uint64_t data[3 + NUM_PERF_EVENTS];
+        ssize_t size = read(group->leader, data, sizeof(data));
+        if (size >= static_cast<ssize_t>(3 * sizeof(uint64_t)) && data[2] > 0) {
+            double scale = static_cast<double>(data[1]) / data[2];
+            for (int e = 0; e < NUM_PERF_EVENTS; e++)
+                if (group->slots[e] >= 0 && group->slots[e] < static_cast<int>(data[0]))
+                    group->totals[e] += data[3 + group->slots[e]] * scale;
+        }
+        group = nullptr;
+    }
+
+private:
+    perf_detail::Group* group;
+};
+
+namespace perf_detail {
+
+inline void print_counts(const double* values, size_t num_pixels) {
+    std::cout << std::fixed;
+    for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+        std::cout << (e ? ", " : "") << perf_event_name(e) << " ";
+        if (values[e] < 0) std::cout << "unavailable";
+        else std::cout << std::setprecision(0) << values[e];
+    }
+    if (values[PERF_CYCLES] > 0 && values[PERF_INSTRUCTIONS] >= 0)
+        std::cout << ", IPC " << std::setprecision(2) << values[PERF_INSTRUCTIONS] / values[PERF_CYCLES];
+    if (values[PERF_LLC_MISSES] >= 0 && num_pixels > 0)
+        std::cout << ", " << std::setprecision(2) << values[PERF_LLC_MISSES] * CACHE_LINE_SIZE / num_pixels
+                  << " bytes/pixel from LLC misses";
+    std::cout << "\n";
+}
+
+} // namespace perf_detail
+
+/**
+ * Print the counts summed over all threads (and ranks), then per thread
+ * when there are several, for an image of num_pixels pixels
+ */
+inline void print_perf_counters(size_t num_pixels) {
+    PerfCounterLog& log = perf_counter_log();
+    std::vector<PerfRecord> records = log.records();
+    double totals[NUM_PERF_EVENTS] = {0, 0, 0, 0};
+    bool counted = false;
+    for (const PerfRecord& record : records) {
+        if (record.values[PERF_CYCLES] < 0) continue;
+        counted = true;
+        for (int e = 0; e < NUM_PERF_EVENTS; e++)
+            totals[e] = (record.values[e] < 0 || totals[e] < 0) ? -1 : totals[e] + record.values[e];
+    }
+    if (!counted) {
+        std::cout << "Counters: unavailable, perf_event_open failed: "
+                  << (log.open_errno ? strerror(log.open_errno) : "no measured scope")
+                  << " (no PMU, or kernel.perf_event_paranoid > 2)\n";
+        return;
+    }
+    std::cout << "Counters: ";
+    perf_detail::print_counts(totals, num_pixels);
+    if (records.size() < 2) return;
+    for (const PerfRecord& record : records) {
+        std::cout << "  Rank " << record.rank << " thread " << record.thread << ": ";
+        perf_detail::print_counts(record.values, num_pixels);
+    }
+}
+
+#endif // CSC4005_PROJECT_1_PERF_COUNTERS_HPP
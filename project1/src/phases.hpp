@@ -0,0 +1,208 @@
+//
+// Scoped phase timers: where the wall time of a run goes (--phases)
+//
+// A PhaseTimer adds the time between its construction and its destruction
+// (or stop()) to one phase of the run: read, deinterleave, compute,
+// communicate, reinterleave or write. PhaseTimer records the scope for the
+// process (rank) as a whole, ThreadPhaseTimer for the calling thread, so a
+// parallel region timed on the main thread and in every worker shows both
+// its wall time and each thread's busy time. Threads are numbered in the
+// order they first record a phase.
+//
+// Instrumentation is off unless enable_phase_log() is called: a disabled
+// timer reads no clock and costs one test of a flag. The MPI executables
+// merge the records of every rank into the master's log with
+// gather_phase_log (mpi_gather.hpp) before it is written as JSON.
+//
+
+#ifndef CSC4005_PROJECT_1_PHASES_HPP
+#define CSC4005_PROJECT_1_PHASES_HPP
+
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+enum class Phase { Read, Deinterleave, Compute, Communicate, Reinterleave, Write };
+
+const int NUM_PHASES = 6;
+
+inline const char* phase_name(int phase) {
+    static const char* names[NUM_PHASES] = {"read", "deinterleave", "compute", "communicate", "reinterleave", "write"};
+    return names[phase];
+}
+
+struct PhaseTotals {
+    double ms[NUM_PHASES];
+    long calls[NUM_PHASES];
+};
+
+// One phase of one thread (thread -1: the rank as a whole)
+struct PhaseRecord {
+    int phase;
+    int rank;
+    int thread;
+    double ms;
+    long calls;
+};
+
+class PhaseLog {
+public:
+    PhaseLog() : enabled(false), rank(0), num_ranks(1), wall() {
+        pthread_mutex_init(&mutex, nullptr);
+    }
+
+    ~PhaseLog() {
+        pthread_mutex_destroy(&mutex);
+    }
+
+    PhaseLog(const PhaseLog&) = delete;
+    PhaseLog& operator=(const PhaseLog&) = delete;
+
+    bool enabled;
+    int rank;
+    int num_ranks;
+    PhaseTotals wall;                   // PhaseTimer, main thread only
+    std::vector<PhaseRecord> imported;  // other ranks', see gather_phase_log
+
+    // Totals of the calling thread, registered on its first call
+    PhaseTotals* thread_totals() {
+        static thread_local PhaseTotals* totals = nullptr;
+        if (totals == nullptr) {
+            pthread_mutex_lock(&mutex);
+            threads.push_back(PhaseTotals());
+            totals = &threads.back();
+            pthread_mutex_unlock(&mutex);
+        }
+        return totals;
+    }
+
+    /**
+     * Non-empty phases of this rank, then the imported ones. Call once the
+     * timed threads are done (joined, parked in their pool or past the end
+     * of their parallel region).
+     */
+    std::vector<PhaseRecord> records() {
+        std::vector<PhaseRecord> result;
+        pthread_mutex_lock(&mutex);
+        append(wall, -1, &result);
+        for (size_t t = 0; t < threads.size(); t++)
+            append(threads[t], static_cast<int>(t), &result);
+        pthread_mutex_unlock(&mutex);
+        result.insert(result.end(), imported.begin(), imported.end());
+        return result;
+    }
+
+private:
+    void append(const PhaseTotals& totals, int thread, std::vector<PhaseRecord>* result) const {
+        for (int p = 0; p < NUM_PHASES; p++)
+            if (totals.calls[p] > 0)
+                result->push_back({p, rank, thread, totals.ms[p], totals.calls[p]});
+    }
+
+    std::deque<PhaseTotals> threads;    // stable addresses as threads register
+    pthread_mutex_t mutex;
+};
+
+inline PhaseLog& phase_log() {
+    static PhaseLog log;
+    return log;
+}
+
+// Called by the main thread before any timer of the run
+inline void enable_phase_log(int rank = 0, int num_ranks = 1) {
+    PhaseLog& log = phase_log();
+    log.rank = rank;
+    log.num_ranks = num_ranks;
+    log.enabled = true;
+}
+
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase phase) : PhaseTimer(phase, false) {}
+
+    ~PhaseTimer() {
+        stop();
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    // End the scope early; later calls do nothing
+    void stop() {
+        if (totals == nullptr) return;
+        totals->ms[phase] += std::chrono::duration<double, std::milli>(Clock::now() - start_time).count();
+        totals->calls[phase]++;
+        totals = nullptr;
+    }
+
+protected:
+    typedef std::chrono::steady_clock Clock;
+
+    PhaseTimer(Phase phase, bool per_thread) : phase(static_cast<int>(phase)), totals(nullptr) {
+        PhaseLog& log = phase_log();
+        if (!log.enabled) return;
+        totals = per_thread ? log.thread_totals() : &log.wall;
+        start_time = Clock::now();
+    }
+
+private:
+    int phase;
+    PhaseTotals* totals;
+    Clock::time_point start_time;
+};
+
+// Phase time of the calling thread, e.g. its band inside a parallel region
+class ThreadPhaseTimer : public PhaseTimer {
+public:
+    explicit ThreadPhaseTimer(Phase phase) : PhaseTimer(phase, true) {}
+};
+
+inline std::string json_string(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20) quoted += c;
+    }
+    return quoted + "\"";
+}
+
+/**
+ * Write the log as one JSON object
+ *
+ *     {"program": ..., "ranks": N, "phases": [{"phase": "read", "rank": 0,
+ *      "thread": -1, "ms": 12.345, "calls": 1}, ...]}
+ *
+ * to the file at target, or to stdout after "Phases: " if target is "1"
+ * (a bare --phases)
+ * @return 0 on success, -1 if the file cannot be written
+ */
+inline int write_phase_log(const std::string& target, const char* program) {
+    PhaseLog& log = phase_log();
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(3);
+    json << "{\"program\": " << json_string(program) << ", \"ranks\": " << log.num_ranks << ", \"phases\": [";
+    std::vector<PhaseRecord> records = log.records();
+    for (size_t i = 0; i < records.size(); i++) {
+        const PhaseRecord& record = records[i];
+        json << (i ? ", " : "") << "{\"phase\": \"" << phase_name(record.phase) << "\", \"rank\": " << record.rank
+             << ", \"thread\": " << record.thread << ", \"ms\": " << record.ms << ", \"calls\": " << record.calls
+             << "}";
+    }
+    json << "]}";
+    if (target == "1") {
+        std::cout << "Phases: " << json.str() << "\n";
+        return 0;
+    }
+    std::ofstream file(target);
+    file << json.str() << "\n";
+    return file ? 0 : -1;
+}
+
+#endif // CSC4005_PROJECT_1_PHASES_HPP
@@ -0,0 +1,209 @@
+//
+// Raw planar image container, read and written through mmap
+//
+
+#include "raw_image.hpp"
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char RAW_IMAGE_MAGIC[8] = {'C', 'S', 'C', 'R', 'A', 'W', '0', '1'};
+
+/**
+ * File header, in host byte order. The planes follow it, plane c at
+ * sizeof(RawImageHeader) + c * plane_stride.
+ */
+struct RawImageHeader {
+    char magic[8];
+    uint32_t width;
+    uint32_t height;
+    uint32_t num_channels;
+    uint32_t color_space;
+    uint64_t plane_stride;      // width * height rounded up to RAW_IMAGE_ALIGNMENT
+    char reserved[32];
+};
+
+static_assert(sizeof(RawImageHeader) == RAW_IMAGE_ALIGNMENT, "planes must start on an aligned offset");
+
+size_t plane_stride(int width, int height) {
+    size_t size = static_cast<size_t>(width) * height;
+    return (size + RAW_IMAGE_ALIGNMENT - 1) / RAW_IMAGE_ALIGNMENT * RAW_IMAGE_ALIGNMENT;
+}
+
+void interleave_planes(const RawImage& raw, unsigned char* buffer) {
+    size_t num_pixels = static_cast<size_t>(raw.width) * raw.height;
+    if (raw.num_channels == 1) {
+        memcpy(buffer, raw.planes[0], num_pixels);
+        return;
+    }
+    for (size_t i = 0; i < num_pixels; i++) {
+        buffer[i * 3] = raw.planes[0][i];
+        buffer[i * 3 + 1] = raw.planes[1][i];
+        buffer[i * 3 + 2] = raw.planes[2][i];
+    }
+}
+
+void set_planes(RawImage* image, size_t stride) {
+    auto base = static_cast<unsigned char*>(image->map) + sizeof(RawImageHeader);
+    for (int c = 0; c < 3; c++)
+        image->planes[c] = c < image->num_channels ? base + c * stride : NULL;
+}
+
+} // namespace
+
+bool is_raw_image_path(const char* filepath) {
+    size_t length = strlen(filepath);
+    return length >= 4 && strcmp(filepath + length - 4, ".raw") == 0;
+}
+
+int map_raw_image(RawImage* image, const char* filepath) {
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(RawImageHeader)) {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);      // the mapping keeps the file open
+    if (map == MAP_FAILED)
+        return -1;
+    const RawImageHeader* header = static_cast<const RawImageHeader*>(map);
+    // The executables size and index images in int, interleaved channels
+    // included: reject empty images and any that would overflow that
+    uint64_t num_values = static_cast<uint64_t>(header->width) * header->height * header->num_channels;
+    if (header->width == 0 || header->height == 0 || num_values > INT_MAX) {
+        munmap(map, st.st_size);
+        return -1;
+    }
+    size_t stride = plane_stride(header->width, header->height);
+    if (memcmp(header->magic, RAW_IMAGE_MAGIC, sizeof(RAW_IMAGE_MAGIC)) != 0
+        || (header->num_channels != 1 && header->num_channels != 3)
+        || header->plane_stride != stride
+        || static_cast<size_t>(st.st_size) < sizeof(RawImageHeader) + header->num_channels * stride) {
+        munmap(map, st.st_size);
+        return -1;
+    }
+    image->width = header->width;
+    image->height = header->height;
+    image->num_channels = header->num_channels;
+    image->color_space = static_cast<J_COLOR_SPACE>(header->color_space);
+    image->map = map;
+    image->map_size = st.st_size;
+    set_planes(image, stride);
+    // The filters stream through the planes front to back
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    return 0;
+}
+
+int create_raw_image(RawImage* image, const char* filepath, int width, int height, int num_channels,
+                     J_COLOR_SPACE color_space) {
+    if (num_channels != 1 && num_channels != 3)
+        return -1;
+    size_t stride = plane_stride(width, height);
+    size_t size = sizeof(RawImageHeader) + num_channels * stride;
+    int fd = open(filepath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+    RawImageHeader header{};
+    memcpy(header.magic, RAW_IMAGE_MAGIC, sizeof(RAW_IMAGE_MAGIC));
+    header.width = width;
+    header.height = height;
+    header.num_channels = num_channels;
+    header.color_space = color_space;
+    header.plane_stride = stride;
+    memcpy(map, &header, sizeof(header));
+    image->width = width;
+    image->height = height;
+    image->num_channels = num_channels;
+    image->color_space = color_space;
+    image->map = map;
+    image->map_size = size;
+    set_planes(image, stride);
+    return 0;
+}
+
+int sync_raw_image(const RawImage* image) {
+    return msync(image->map, image->map_size, MS_SYNC) == 0 ? 0 : -1;
+}
+
+void unmap_raw_image(RawImage* image) {
+    if (image->map != NULL)
+        munmap(image->map, image->map_size);
+    image->map = NULL;
+}
+
+JPEGMeta read_image(const char* filepath, J_COLOR_SPACE out_color_space, const CodecProfile& profile) {
+    if (!is_raw_image_path(filepath))
+        return read_from_jpeg(filepath, out_color_space, profile);
+    RawImage raw;
+    if (map_raw_image(&raw, filepath))
+        return {NULL, 0, 0, 0, JCS_UNKNOWN};
+    auto buffer = new unsigned char[static_cast<size_t>(raw.width) * raw.height * raw.num_channels];
+    interleave_planes(raw, buffer);
+    JPEGMeta meta{buffer, raw.width, raw.height, raw.num_channels, raw.color_space};
+    unmap_raw_image(&raw);
+    return meta;
+}
+
+int read_image_into(const char* filepath, std::vector<unsigned char>* buffer, JPEGMeta* image,
+                    const CodecProfile& profile) {
+    if (is_raw_image_path(filepath)) {
+        RawImage raw;
+        if (map_raw_image(&raw, filepath))
+            return -1;
+        buffer->resize(static_cast<size_t>(raw.width) * raw.height * raw.num_channels);
+        interleave_planes(raw, buffer->data());
+        *image = {buffer->data(), raw.width, raw.height, raw.num_channels, raw.color_space};
+        unmap_raw_image(&raw);
+        return 0;
+    }
+    JPEGReader reader;
+    if (open_jpeg_reader(&reader, filepath, JCS_UNKNOWN, profile))
+        return -1;
+    size_t row_size = static_cast<size_t>(reader.width) * reader.num_channels;
+    buffer->resize(row_size * reader.height);
+    for (int y = 0; y < reader.height; y++)
+        if (read_jpeg_row(&reader, buffer->data() + y * row_size))
+            break;
+    *image = {buffer->data(), reader.width, reader.height, reader.num_channels, reader.color_space};
+    return close_jpeg_reader(&reader);
+}
+
+int write_image(const JPEGMeta& data, const char* filepath, const CodecProfile& profile) {
+    if (!is_raw_image_path(filepath))
+        return write_to_jpeg(data, filepath, profile);
+    RawImage raw;
+    if (create_raw_image(&raw, filepath, data.width, data.height, data.num_channels, data.color_space))
+        return -1;
+    size_t num_pixels = static_cast<size_t>(data.width) * data.height;
+    if (data.num_channels == 1) {
+        memcpy(raw.planes[0], data.buffer, num_pixels);
+    } else {
+        for (size_t i = 0; i < num_pixels; i++) {
+            raw.planes[0][i] = data.buffer[i * 3];
+            raw.planes[1][i] = data.buffer[i * 3 + 1];
+            raw.planes[2][i] = data.buffer[i * 3 + 2];
+        }
+    }
+    int result = sync_raw_image(&raw);
+    unmap_raw_image(&raw);
+    return result;
+}
@@ -0,0 +1,88 @@
+//
+// Raw planar image container, read and written through mmap
+//
+// A .raw file is a 64-byte header followed by one plane per channel (R, G,
+// B or a single gray plane), every plane starting on a 64-byte boundary.
+// Mapping the file gives the planes in place with no decoding and, for
+// repeated runs on the same image, straight from the page cache; only
+// openmp_PartB filters the mapped planes without a copy. Executables pick
+// the container by the file extension: read_image and read_image_into take
+// .raw files too, interleaving the planes into a new buffer, and
+// write_image writes them; anything else goes through libjpeg.
+//
+
+#ifndef CSC4005_PROJECT_1_RAW_IMAGE_HPP
+#define CSC4005_PROJECT_1_RAW_IMAGE_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "utils.hpp"
+
+#define RAW_IMAGE_ALIGNMENT 64
+
+/**
+ * A mapped raw image: planes[c] holds width * height bytes of channel c,
+ * planes of a 1 channel image past planes[0] are NULL
+ */
+struct RawImage {
+    unsigned char* planes[3];
+    int width;
+    int height;
+    int num_channels;
+    J_COLOR_SPACE color_space;
+    void* map;          // whole file mapping
+    size_t map_size;
+};
+
+/**
+ * Whether filepath names a raw image (ends in .raw)
+ */
+bool is_raw_image_path(const char* filepath);
+
+/**
+ * Map a raw image file read-only
+ * @return 0 on success, -1 if the file cannot be opened or is not a raw image
+ */
+int map_raw_image(RawImage* image, const char* filepath);
+
+/**
+ * Create (or truncate) a raw image file of the given geometry and map it
+ * for writing; fill the planes, then sync_raw_image and unmap_raw_image
+ * @return 0 on success, -1 on error
+ */
+int create_raw_image(RawImage* image, const char* filepath, int width, int height, int num_channels,
+                     J_COLOR_SPACE color_space);
+
+/**
+ * Flush the planes written through the mapping to the file (msync)
+ * @return 0 on success, -1 on error
+ */
+int sync_raw_image(const RawImage* image);
+
+void unmap_raw_image(RawImage* image);
+
+/**
+ * Read a .raw image into an interleaved buffer, or any other file with
+ * read_from_jpeg. out_color_space and profile only apply to JPEG files,
+ * raw images come back as stored.
+ */
+JPEGMeta read_image(const char* filepath, J_COLOR_SPACE out_color_space = JCS_UNKNOWN,
+                    const CodecProfile& profile = CodecProfile());
+
+/**
+ * read_image into a caller-owned buffer that is grown as needed and can be
+ * reused from one image to the next; image->buffer points into it
+ * @return 0 on success, -1 on error
+ */
+int read_image_into(const char* filepath, std::vector<unsigned char>* buffer, JPEGMeta* image,
+                    const CodecProfile& profile = CodecProfile());
+
+/**
+ * Write an interleaved buffer as a .raw image, or any other file with
+ * write_to_jpeg
+ * @return 0 on success, -1 on error
+ */
+int write_image(const JPEGMeta& data, const char* filepath, const CodecProfile& profile = CodecProfile());
+
+#endif // CSC4005_PROJECT_1_RAW_IMAGE_HPP
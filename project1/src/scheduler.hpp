@@ -0,0 +1,208 @@
+//
+// Static and work-stealing schedules of chunked work on a ThreadPool
+//
+// The work is a range of chunks [0, num_chunks), e.g. bands of `grain`
+// rows. The static schedule gives each worker one contiguous share. The
+// work-stealing schedule starts from the same shares, but every worker
+// keeps its share in a Chase-Lev deque: it pops its own chunks from the
+// bottom, in order, and once it runs dry it steals single chunks from the
+// top (the far end) of a random victim. A preempted or slow worker thus
+// loses the tail of its share to idle ones, and the end of the run is
+// imbalanced by at most one chunk, however uneven the workers' speeds.
+//
+
+#ifndef CSC4005_PROJECT_1_SCHEDULER_HPP
+#define CSC4005_PROJECT_1_SCHEDULER_HPP
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <sched.h>
+
+#include "thread_pool.hpp"
+
+enum class Schedule { Static, Steal };
+
+inline bool parse_schedule(const std::string& name, Schedule* schedule) {
+    if (name == "static") *schedule = Schedule::Static;
+    else if (name == "steal") *schedule = Schedule::Steal;
+    else return false;
+    return true;
+}
+
+/**
+ * Chase-Lev work-stealing deque of chunk indices (Le, Pop, Cohen and
+ * Zappa Nardelli's C11 formulation). push / pop are called by the owner
+ * only, steal by any thread. The capacity is fixed: the schedule pushes
+ * every chunk before the workers start, so the buffer never grows.
+ */
+class WorkStealingDeque {
+public:
+    WorkStealingDeque() : top(0), bottom(0), mask(0) {}
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    void reset(int capacity) {
+        long size = 1;
+        while (size < capacity) size <<= 1;
+        buffer = std::vector<std::atomic<int>>(size);
+        mask = size - 1;
+        top.store(0, std::memory_order_relaxed);
+        bottom.store(0, std::memory_order_relaxed);
+    }
+
+    void push(int value) {
+        long b = bottom.load(std::memory_order_relaxed);
+        buffer[b & mask].store(value, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    bool pop(int* value) {
+        long b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            // Empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        *value = buffer[b & mask].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last element: race the thieves for it
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                   std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    bool steal(int* value) {
+        long t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return false;
+        int candidate = buffer[t & mask].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed))
+            return false;   // lost the race to the owner or another thief
+        *value = candidate;
+        return true;
+    }
+
+private:
+    // top is written by thieves, bottom by the owner: keep them on
+    // separate cache lines
+    std::atomic<long> top;
+    char padding[64];
+    std::atomic<long> bottom;
+    std::vector<std::atomic<int>> buffer;
+    long mask;
+};
+
+namespace sched_detail {
+
+// Contiguous share of worker w among num_workers
+inline int share_begin(int num_chunks, int num_workers, int w) {
+    return static_cast<long>(num_chunks) * w / num_workers;
+}
+
+template <typename Body>
+struct StaticTask {
+    const Body* body;
+    int chunk_begin;
+    int chunk_end;
+};
+
+template <typename Body>
+void* static_worker(void* arg) {
+    StaticTask<Body>* task = reinterpret_cast<StaticTask<Body>*>(arg);
+    for (int chunk = task->chunk_begin; chunk < task->chunk_end; chunk++)
+        (*task->body)(chunk);
+    return nullptr;
+}
+
+template <typename Body>
+struct StealTask {
+    const Body* body;
+    std::vector<WorkStealingDeque>* deques;
+    std::atomic<int>* unclaimed;    // chunks not yet popped nor stolen
+    int worker;
+    long steals;
+};
+
+template <typename Body>
+void* steal_worker(void* arg) {
+    StealTask<Body>* task = reinterpret_cast<StealTask<Body>*>(arg);
+    std::vector<WorkStealingDeque>& deques = *task->deques;
+    const int num_workers = static_cast<int>(deques.size());
+    WorkStealingDeque& own = deques[task->worker];
+    unsigned int seed = 2654435761u * (task->worker + 1);
+    int chunk;
+    while (task->unclaimed->load(std::memory_order_relaxed) > 0) {
+        if (own.pop(&chunk)) {
+            task->unclaimed->fetch_sub(1, std::memory_order_relaxed);
+            (*task->body)(chunk);
+            continue;
+        }
+        // Own share done: try every other worker once, from a random start
+        bool stolen = false;
+        seed = seed * 1664525u + 1013904223u;
+        for (int i = 0; i < num_workers && !stolen; i++) {
+            int victim = (seed / 65536 + i) % num_workers;
+            if (victim != task->worker && deques[victim].steal(&chunk))
+                stolen = true;
+        }
+        if (stolen) {
+            task->unclaimed->fetch_sub(1, std::memory_order_relaxed);
+            task->steals++;
+            (*task->body)(chunk);
+        } else {
+            sched_yield();
+        }
+    }
+    return nullptr;
+}
+
+} // namespace sched_detail
+
+/**
+ * Run body(chunk) for every chunk in [0, num_chunks) on all pool workers
+ * and wait for the batch.
+ * @return number of chunks taken by work stealing (0 for Schedule::Static)
+ */
+template <typename Body>
+long run_schedule(ThreadPool& pool, Schedule schedule, int num_chunks, const Body& body) {
+    const int num_workers = pool.size();
+    if (schedule == Schedule::Static) {
+        std::vector<sched_detail::StaticTask<Body>> tasks(num_workers);
+        for (int w = 0; w < num_workers; w++)
+            tasks[w] = {&body, sched_detail::share_begin(num_chunks, num_workers, w),
+                        sched_detail::share_begin(num_chunks, num_workers, w + 1)};
+        pool.run(sched_detail::static_worker<Body>, tasks.data(), num_workers);
+        return 0;
+    }
+    std::vector<WorkStealingDeque> deques(num_workers);
+    std::atomic<int> unclaimed(num_chunks);
+    std::vector<sched_detail::StealTask<Body>> tasks(num_workers);
+    for (int w = 0; w < num_workers; w++) {
+        int begin = sched_detail::share_begin(num_chunks, num_workers, w);
+        int end = sched_detail::share_begin(num_chunks, num_workers, w + 1);
+        // Pushed in reverse so the owner pops its share front to back and
+        // thieves take the far end
+        deques[w].reset(end - begin);
+        for (int chunk = end - 1; chunk >= begin; chunk--)
+            deques[w].push(chunk);
+        tasks[w] = {&body, &deques, &unclaimed, w, 0};
+    }
+    pool.run(sched_detail::steal_worker<Body>, tasks.data(), num_workers);
+    long steals = 0;
+    for (const auto& task : tasks) steals += task.steals;
+    return steals;
+}
+
+#endif // CSC4005_PROJECT_1_SCHEDULER_HPP
@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+#
+# Local benchmark driver, the counterpart of sbatch_PartA.sh / sbatch_PartB.sh
+# for a single Linux machine without Slurm
+#
+# Sweeps the CPU backends over worker counts, runs every configuration
+# --warmup times untimed and --trials times timed, and reports the median,
+# minimum and standard deviation of the "Execution Time" each program
+# prints, the throughput in megapixels/s and the speedup and efficiency
+# against the sequential program of the same part. Results can be written
+# as CSV and / or JSON to compare builds over time.
+#
+# The programs print whole milliseconds, which on small images rounds every
+# time to 0; a part with such a time is timed on the wall clock of the whole
+# process instead (--timing), and its rows say so.
+#
+# Example, from the project root after building into build/:
+#   python3 src/scripts/benchmark.py --part=B --threads=1,2,4,8 --json=results.json
+#
+
+import argparse
+import csv
+import datetime
+import json
+import os
+import re
+import socket
+import statistics
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+PROJECT_DIR = os.path.normpath(os.path.join(SCRIPT_DIR, "..", ".."))
+BACKENDS = ["sequential", "simd", "mpi", "pthread", "openmp", "hybrid"]
+TIME_PATTERN = re.compile(r"^Execution Time[^:]*: (\d+(?:\.\d+)?) milliseconds", re.M)
+
+
+def image_pixels(path):
+    """Width * height from a JPEG SOF marker or a raw image header"""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:8] == b"CSCRAW01":
+        width, height = struct.unpack_from("<II", data, 8)
+        return width * height
+    pos = 2
+    while pos + 4 <= len(data):
+        if data[pos] != 0xFF:
+            pos += 1
+            continue
+        marker = data[pos + 1]
+        length = struct.unpack_from(">H", data, pos + 2)[0]
+        # SOF0 to SOF15, except DHT (C4), JPG (C8) and DAC (CC)
+        if 0xC0 <= marker <= 0xCF and marker not in (0xC4, 0xC8, 0xCC):
+            height, width = struct.unpack_from(">HH", data, pos + 5)
+            return width * height
+        pos += 2 + length
+    raise ValueError("no frame header in " + path)
+
+
+def configurations(part, backends, workers_list):
+    """(backend, workers, ranks, threads) to run; sequential comes first"""
+    configs = [("sequential", 1, 1, 1)]
+    for backend in backends:
+        if backend == "sequential":
+            continue
+        if backend == "simd":
+            configs.append(("simd", 1, 1, 1))
+        elif backend == "hybrid":
+            # Two ranks, the workers split between them
+            if part == "B":
+                configs += [("hybrid", n, 2, n // 2) for n in workers_list if n >= 2 and n % 2 == 0]
+        elif backend == "mpi":
+            configs += [("mpi", n, n, 1) for n in workers_list]
+        else:
+            configs += [(backend, n, 1, n) for n in workers_list]
+    return configs
+
+
+def command(args, part, backend, ranks, threads, output):
+    executable = os.path.join(args.build, "%s_Part%s" % (backend, part))
+    cmd = [executable, args.image, output]
+    if backend in ("pthread", "hybrid") or (backend == "openmp" and part == "B"):
+        cmd.append(str(threads))
+    if part == "B":
+        cmd.append("--kernel=%d" % args.kernel)
+    cmd += args.extra
+    if backend in ("mpi", "hybrid"):
+        cmd = args.mpirun.split() + ["-n", str(ranks)] + cmd
+    return cmd
+
+
+def run_once(cmd, threads):
+    """(printed execution time, wall clock time of the process) in ms"""
+    env = dict(os.environ, OMP_NUM_THREADS=str(threads))
+    start = time.perf_counter()
+    result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, env=env,
+                            universal_newlines=True)
+    wall = (time.perf_counter() - start) * 1000
+    match = TIME_PATTERN.search(result.stdout)
+    if result.returncode != 0 or match is None:
+        raise RuntimeError("%s failed:\n%s" % (" ".join(cmd), result.stdout))
+    return float(match.group(1)), wall
+
+
+def git_revision():
+    try:
+        return subprocess.check_output(["git", "rev-parse", "--short", "HEAD"], cwd=PROJECT_DIR,
+                                       stderr=subprocess.DEVNULL, universal_newlines=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Local benchmark sweep of the CPU backends")
+    parser.add_argument("--build", default=os.path.join(PROJECT_DIR, "build", "src", "cpu"),
+                        help="directory of the CPU executables")
+    parser.add_argument("--image", default=os.path.join(PROJECT_DIR, "images", "4k-RGB.jpg"))
+    parser.add_argument("--part", choices=["A", "B", "both"], default="both")
+    parser.add_argument("--backends", default=",".join(BACKENDS))
+    parser.add_argument("--threads", default=None,
+                        help="comma separated worker counts, default powers of two up to the CPU count")
+    parser.add_argument("--kernel", type=int, default=3, help="PartB filter size")
+    parser.add_argument("--warmup", type=int, default=1)
+    parser.add_argument("--trials", type=int, default=5)
+    parser.add_argument("--timing", choices=["auto", "reported", "wall"], default="auto",
+                        help="time from the printed Execution Time, the process wall clock, or auto: "
+                             "the wall clock when a printed median of the part is 0 ms")
+    parser.add_argument("--mpirun", default="mpirun", help="MPI launcher, e.g. 'mpirun --oversubscribe'")
+    parser.add_argument("--csv", help="write the results as CSV to this file")
+    parser.add_argument("--json", help="write the results and the run's metadata as JSON to this file")
+    parser.add_argument("extra", nargs="*", help="switches passed to every executable, after --")
+    args = parser.parse_args()
+
+    if args.threads:
+        workers_list = [int(n) for n in args.threads.split(",")]
+    else:
+        workers_list = [1]
+        while workers_list[-1] * 2 <= os.cpu_count():
+            workers_list.append(workers_list[-1] * 2)
+    backends = args.backends.split(",")
+    for backend in backends:
+        if backend not in BACKENDS:
+            parser.error("unknown backend %s, should be among %s" % (backend, ", ".join(BACKENDS)))
+    if args.trials < 1 or args.warmup < 0:
+        parser.error("--trials must be positive and --warmup non-negative")
+    megapixels = image_pixels(args.image) / 1e6
+    parts = ["A", "B"] if args.part == "both" else [args.part]
+
+    results = []
+    with tempfile.TemporaryDirectory() as scratch:
+        for part in parts:
+            print("Part%s, %s (%.1f MP), %d warm-up + %d trials" %
+                  (part, os.path.basename(args.image), megapixels, args.warmup, args.trials))
+            # Run the whole part first: whether the printed times are usable
+            # is only known once every configuration has run
+            measured = []
+            for backend, workers, ranks, threads in configurations(part, backends, workers_list):
+                output = os.path.join(scratch, "output.jpg")
+                cmd = command(args, part, backend, ranks, threads, output)
+                try:
+                    for _ in range(args.warmup):
+                        run_once(cmd, threads)
+                    runs = [run_once(cmd, threads) for _ in range(args.trials)]
+                except (OSError, RuntimeError) as error:
+                    print("%-10s %7d skipped: %s" % (backend, workers, str(error).splitlines()[0]),
+                          file=sys.stderr)
+                    continue
+                measured.append((backend, workers, ranks, threads, runs))
+            below_resolution = any(statistics.median(run[0] for run in runs) == 0
+                                   for _, _, _, _, runs in measured)
+            timing = args.timing
+            if timing == "auto":
+                timing = "wall" if below_resolution else "reported"
+            if below_resolution:
+                print("Execution Time below the programs' 1 ms resolution, %s" %
+                      ("timing the whole process instead" if timing == "wall"
+                       else "the rows at 0 ms have no throughput or speedup"))
+            if not any(backend == "sequential" for backend, _, _, _, _ in measured):
+                print("No sequential baseline, speedup and efficiency are not computed", file=sys.stderr)
+            print("%-10s %7s %11s %9s %9s %8s %8s %10s" %
+                  ("backend", "workers", "median (ms)", "min (ms)", "stddev", "MP/s", "speedup", "efficiency"))
+            baseline = None
+            for backend, workers, ranks, threads, runs in measured:
+                times = [run[1] if timing == "wall" else run[0] for run in runs]
+                median = statistics.median(times)
+                if backend == "sequential":
+                    baseline = median
+                speedup = baseline / median if baseline and median > 0 else None
+                row = {
+                    "part": part, "backend": backend, "workers": workers, "ranks": ranks, "threads": threads,
+                    "trials": args.trials, "timing": timing, "median_ms": median, "min_ms": min(times),
+                    "stddev_ms": statistics.stdev(times) if len(times) > 1 else 0.0,
+                    "megapixels_per_s": megapixels / median * 1000 if median > 0 else None,
+                    "speedup": speedup, "efficiency": speedup / workers if speedup else None,
+                    "times_ms": times,
+                }
+                results.append(row)
+                print("%-10s %7d %11.1f %9.1f %9.1f %8s %8s %10s" % (
+                    backend, workers, median, row["min_ms"], row["stddev_ms"],
+                    "%.1f" % row["megapixels_per_s"] if row["megapixels_per_s"] else "-",
+                    "%.2f" % speedup if speedup else "-",
+                    "%.2f" % row["efficiency"] if row["efficiency"] else "-"))
+            print()
+
+    if args.csv:
+        columns = ["part", "backend", "workers", "ranks", "threads", "trials", "timing", "median_ms", "min_ms",
+                   "stddev_ms", "megapixels_per_s", "speedup", "efficiency"]
+        with open(args.csv, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=columns, extrasaction="ignore")
+            writer.writeheader()
+            writer.writerows(results)
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({
+                "date": datetime.datetime.now().isoformat(timespec="seconds"),
+                "host": socket.gethostname(),
+                "cpus": os.cpu_count(),
+                "revision": git_revision(),
+                "image": os.path.basename(args.image),
+                "megapixels": megapixels,
+                "kernel": args.kernel,
+                "extra": args.extra,
+                "results": results,
+            }, f, indent=2)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
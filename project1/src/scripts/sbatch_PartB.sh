@@ -47,6 +47,26 @@ do
   echo ""
 done
 
+# OpenMP PartB with larger box filters (running sums, cost independent of the size)
+echo "OpenMP PartB box filter sizes (Optimized with -O2)"
+for kernel_size in 3 11 31 101
+do
+  echo "Kernel size: $kernel_size"
+  srun -n 1 --cpus-per-task 32 ${CURRENT_DIR}/../../build/src/cpu/openmp_PartB ${CURRENT_DIR}/../../images/20K-RGB.jpg ${CURRENT_DIR}/../../images/20K-SmoothOMP-Box${kernel_size}.jpg 32 --kernel=${kernel_size} --mode=box
+  echo ""
+done
+
+# Hybrid MPI + OpenMP PartB: ranks x threads per rank = 32 cores
+# (one rank per node or socket on multi-node jobs)
+echo "Hybrid MPI + OpenMP PartB (Optimized with -O2)"
+for num_processes in 1 2 4
+do
+  num_threads=$((32 / num_processes))
+  echo "Number of processes: $num_processes, threads per process: $num_threads"
+  srun -n $num_processes --cpus-per-task $num_threads --mpi=pmi2 ${CURRENT_DIR}/../../build/src/cpu/hybrid_PartB ${CURRENT_DIR}/../../images/20K-RGB.jpg ${CURRENT_DIR}/../../images/20K-SmoothHybrid${num_processes}x${num_threads}.jpg ${num_threads}
+  echo ""
+done
+
 # CUDA PartB
 echo "CUDA PartB"
 srun -n 1 --gpus 1 ${CURRENT_DIR}/../../build/src/gpu/cuda_PartB ${CURRENT_DIR}/../../images/20K-RGB.jpg ${CURRENT_DIR}/../../images/20K-Smooth-CUDA.jpg
@@ -0,0 +1,63 @@
+//
+// Persistent pthread worker pool shared by the pthread executables
+//
+
+#include "thread_pool.hpp"
+
+ThreadPool::ThreadPool(int num_threads) : workers(num_threads), pending(0), stopping(false) {
+    pthread_mutex_init(&mutex, nullptr);
+    pthread_cond_init(&task_ready, nullptr);
+    pthread_cond_init(&all_done, nullptr);
+    for (int i = 0; i < num_threads; i++)
+        pthread_create(&workers[i], nullptr, worker_main, this);
+}
+
+ThreadPool::~ThreadPool() {
+    pthread_mutex_lock(&mutex);
+    stopping = true;
+    pthread_cond_broadcast(&task_ready);
+    pthread_mutex_unlock(&mutex);
+    for (pthread_t& worker : workers)
+        pthread_join(worker, nullptr);
+    pthread_cond_destroy(&all_done);
+    pthread_cond_destroy(&task_ready);
+    pthread_mutex_destroy(&mutex);
+}
+
+void ThreadPool::submit(TaskFunction function, void* arg) {
+    pthread_mutex_lock(&mutex);
+    tasks.push_back({function, arg});
+    pending++;
+    pthread_cond_signal(&task_ready);
+    pthread_mutex_unlock(&mutex);
+}
+
+void ThreadPool::wait() {
+    pthread_mutex_lock(&mutex);
+    while (pending > 0)
+        pthread_cond_wait(&all_done, &mutex);
+    pthread_mutex_unlock(&mutex);
+}
+
+void* ThreadPool::worker_main(void* arg) {
+    ThreadPool* pool = reinterpret_cast<ThreadPool*>(arg);
+    pthread_mutex_lock(&pool->mutex);
+    while (true) {
+        // Park until there is work or the pool shuts down
+        while (pool->tasks.empty() && !pool->stopping)
+            pthread_cond_wait(&pool->task_ready, &pool->mutex);
+        if (pool->tasks.empty())
+            break;
+        Task task = pool->tasks.front();
+        pool->tasks.pop_front();
+        pthread_mutex_unlock(&pool->mutex);
+
+        task.function(task.arg);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->pending == 0)
+            pthread_cond_broadcast(&pool->all_done);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return nullptr;
+}
@@ -0,0 +1,64 @@
+//
+// Persistent pthread worker pool shared by the pthread executables
+//
+// Workers are started once and park on a condition variable between
+// batches, so thread creation and teardown are not part of the per-image
+// cost. Tasks use the pthread start routine signature, so the existing
+// worker functions run unchanged.
+//
+
+#ifndef CSC4005_PROJECT_1_THREAD_POOL_HPP
+#define CSC4005_PROJECT_1_THREAD_POOL_HPP
+
+#include <deque>
+#include <vector>
+
+#include <pthread.h>
+
+typedef void* (*TaskFunction)(void*);
+
+class ThreadPool {
+public:
+    explicit ThreadPool(int num_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return static_cast<int>(workers.size()); }
+
+    // Queue one task, a parked worker picks it up
+    void submit(TaskFunction function, void* arg);
+
+    // Block until every submitted task has finished
+    void wait();
+
+    /**
+     * Run one batch: function(&args[i]) for i in [0, count), e.g. one
+     * ThreadData row range each, and wait for all of them
+     */
+    template <typename T>
+    void run(TaskFunction function, T* args, int count) {
+        for (int i = 0; i < count; i++)
+            submit(function, &args[i]);
+        wait();
+    }
+
+private:
+    struct Task {
+        TaskFunction function;
+        void* arg;
+    };
+
+    static void* worker_main(void* arg);
+
+    std::vector<pthread_t> workers;
+    std::deque<Task> tasks;
+    int pending;    // queued + running tasks
+    bool stopping;
+    pthread_mutex_t mutex;
+    pthread_cond_t task_ready;
+    pthread_cond_t all_done;
+};
+
+#endif // CSC4005_PROJECT_1_THREAD_POOL_HPP
@@ -0,0 +1,107 @@
+//
+// Cache-blocked (tiled) execution of the PartB filters
+//
+// The image is cut into tiles of tile_width x tile_height output pixels.
+// A tile reads its pixels plus a halo of K/2 rows and columns on each side;
+// the default shape keeps that input block and the tile's output within
+// half of the L2 cache, so the K input rows around every output row and the
+// halo shared by vertically adjacent rows stay resident.
+//
+
+#ifndef CSC4005_PROJECT_1_TILING_HPP
+#define CSC4005_PROJECT_1_TILING_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+struct TileShape {
+    int width;
+    int height;
+};
+
+struct Tile {
+    int row_begin;
+    int row_end;
+    int col_begin;
+    int col_end;
+};
+
+// Per-core L2 size in bytes, 1 MB when the system does not report it
+inline long l2_cache_size() {
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (size > 0) return size;
+#endif
+    return 1L << 20;
+}
+
+/**
+ * Default tile for an image: rows of up to 1024 pixels (long contiguous
+ * runs for the prefetcher), then as many rows as fit half of the L2 cache
+ * with the input halo and the output tile.
+ */
+inline TileShape default_tile_shape(int width, int height, int kernel_size, int num_channels) {
+    const int halo = kernel_size - 1;
+    TileShape shape;
+    shape.width = width < 1024 ? width : 1024;
+    const long budget = l2_cache_size() / 2;
+    const long input_row = static_cast<long>(shape.width + halo) * num_channels;
+    const long output_row = static_cast<long>(shape.width) * num_channels;
+    long rows = (budget - halo * input_row) / (input_row + output_row);
+    if (rows < kernel_size) rows = kernel_size;
+    shape.height = rows < height ? static_cast<int>(rows) : height;
+    return shape;
+}
+
+/**
+ * Parse a `--tile` value: "WxH" for an explicit shape, "auto" (or the bare
+ * switch, stored as "1") for default_tile_shape.
+ * @return false if the value is malformed
+ */
+inline bool parse_tile_shape(const std::string& value, int width, int height, int kernel_size,
+                             int num_channels, TileShape* shape) {
+    if (value == "auto" || value == "1") {
+        *shape = default_tile_shape(width, height, kernel_size, num_channels);
+        return true;
+    }
+    int tile_width, tile_height;
+    char tail;
+    if (std::sscanf(value.c_str(), "%dx%d%c", &tile_width, &tile_height, &tail) != 2 ||
+        tile_width <= 0 || tile_height <= 0)
+        return false;
+    shape->width = tile_width < width ? tile_width : width;
+    shape->height = tile_height < height ? tile_height : height;
+    return true;
+}
+
+inline int num_tiles(const TileShape& shape, int width, int height) {
+    return ((width + shape.width - 1) / shape.width) * ((height + shape.height - 1) / shape.height);
+}
+
+// Bounds of tile `index`, tiles numbered row-major
+inline Tile tile_at(const TileShape& shape, int width, int height, int index) {
+    const int tiles_per_row = (width + shape.width - 1) / shape.width;
+    Tile tile;
+    tile.row_begin = (index / tiles_per_row) * shape.height;
+    tile.col_begin = (index % tiles_per_row) * shape.width;
+    tile.row_end = tile.row_begin + shape.height < height ? tile.row_begin + shape.height : height;
+    tile.col_end = tile.col_begin + shape.width < width ? tile.col_begin + shape.width : width;
+    return tile;
+}
+
+/**
+ * Print the bandwidth achieved by a filter pass over an image of
+ * image_bytes: every byte is read once and written once, the halo re-reads
+ * are expected to hit the cache and are not counted
+ */
+template <typename Duration>
+void print_bandwidth(size_t image_bytes, Duration elapsed) {
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(elapsed).count();
+    std::cout << "Bandwidth: " << 2.0 * image_bytes / seconds / 1e9 << " GB/s\n";
+}
+
+#endif // CSC4005_PROJECT_1_TILING_HPP
@@ -0,0 +1,100 @@
+//
+// Unix domain stream sockets and the line protocol of filter_daemon
+//
+// One request per connection: the client sends a single line of
+// tab-separated fields
+//
+//     <op>\t<kernel>\t<input path>\t<output path>\n
+//
+// with op "filter" (PartB, equal weight filter of size kernel) or "gray"
+// (PartA, kernel ignored), or just "shutdown\n". The daemon answers with
+//
+//     ok\t<decode ms>\t<compute ms>\t<encode ms>\t<total ms>\n
+//
+// or "error\t<message>\n", then closes the connection.
+//
+
+#ifndef CSC4005_PROJECT_1_UNIX_SOCKET_HPP
+#define CSC4005_PROJECT_1_UNIX_SOCKET_HPP
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+inline bool make_socket_address(const char* path, sockaddr_un* address) {
+    if (strlen(path) >= sizeof(address->sun_path))
+        return false;
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    strcpy(address->sun_path, path);
+    return true;
+}
+
+/**
+ * Bind a listening socket at path, replacing a stale socket file
+ * @return the socket, -1 on error
+ */
+inline int listen_unix_socket(const char* path, int backlog) {
+    sockaddr_un address;
+    if (!make_socket_address(path, &address))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    unlink(path);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, backlog) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @return a socket connected to path, -1 on error
+ */
+inline int connect_unix_socket(const char* path) {
+    sockaddr_un address;
+    if (!make_socket_address(path, &address))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+inline bool send_line(int fd, const std::string& line) {
+    std::string data = line + "\n";
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+/**
+ * Read up to the next newline (dropped), false if the peer closed first
+ */
+inline bool receive_line(int fd, std::string* line) {
+    line->clear();
+    char c;
+    while (true) {
+        ssize_t n = recv(fd, &c, 1, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        if (c == '\n') return true;
+        line->push_back(c);
+    }
+}
+
+#endif // CSC4005_PROJECT_1_UNIX_SOCKET_HPP
@@ -1,76 +1,223 @@
-//
-// Created by Liu Yuxuan on 2023/9/15.
-// Email: yuxuanliu1@link.cuhk.edu.cm
-//
-// General utility function to read / write JPEG image with libjpeg
-//
-
-#include "utils.hpp"
-
-/**
- * Read buffer data and other metadata from JPEG file
- * @param filepath
- * @return
- */
-JPEGMeta read_from_jpeg(const char* filepath) {
-    // Open file to read from
-    FILE* file = fopen(filepath, "rb");
-    if (file == NULL)
-        return {NULL, 0, 0, 0};
-    // Initialize JPEG Decoder
-    struct jpeg_decompress_struct cinfo{};
-    struct jpeg_error_mgr jerr{};
-    cinfo.err = jpeg_std_error(&jerr);
-    jpeg_create_decompress(&cinfo);
-    jpeg_stdio_src(&cinfo, file);
-    // Read JPEG Header
-    jpeg_read_header(&cinfo, TRUE);
-    jpeg_start_decompress(&cinfo);
-    int width = cinfo.output_width;
-    int height = cinfo.output_height;
-    int numChannels = cinfo.output_components;
-    // Read RGB buffer data from JPEG
-    auto rgbImage = new unsigned char[width * height * numChannels];
-    while (cinfo.output_scanline < cinfo.output_height) {
-        unsigned char* rowPtr = rgbImage + cinfo.output_scanline * width * numChannels;
-        jpeg_read_scanlines(&cinfo, &rowPtr, 1);
-    }
-    fclose(file);   // Close jpeg file
-    return {rgbImage, width, height, numChannels, cinfo.out_color_space};
-}
-
-/**
- * Write buffer data into JPEG file stored under the filepath
- * @param data
- * @param filepath
- * @return 0 on success, -1 on error
- */
-int write_to_jpeg(const JPEGMeta &data, const char* filepath) {
-    // Open jpeg file to write to
-    FILE* outputFile = fopen(filepath, "wb");
-    if (outputFile == NULL)
-        return -1;
-    // Initialize JPEG Header
-    struct jpeg_compress_struct cinfoOut{};
-    struct jpeg_error_mgr jerrOut{};
-    cinfoOut.err = jpeg_std_error(&jerrOut);
-    jpeg_create_compress(&cinfoOut);
-    jpeg_stdio_dest(&cinfoOut, outputFile);
-    cinfoOut.image_width = data.width;
-    cinfoOut.image_height = data.height;
-    cinfoOut.input_components = data.num_channels;
-    cinfoOut.in_color_space = data.color_space;
-    jpeg_set_defaults(&cinfoOut);
-    jpeg_set_quality(&cinfoOut, 100, TRUE);
-    jpeg_start_compress(&cinfoOut, TRUE);
-    // Write buffer data to jpeg
-    while (cinfoOut.next_scanline < cinfoOut.image_height) {
-        unsigned char* rowPtr = data.buffer + cinfoOut.next_scanline * data.width * data.num_channels;
-        jpeg_write_scanlines(&cinfoOut, &rowPtr, 1);
-    }
-    jpeg_finish_compress(&cinfoOut);
-    jpeg_destroy_compress(&cinfoOut);
-    fclose(outputFile); // Close jpeg file
-    return 0;
-}
-
+//
+// Created by Liu Yuxuan on 2023/9/15.
+// Email: yuxuanliu1@link.cuhk.edu.cm
+//
+// General utility function to read / write JPEG image with libjpeg
+//
+
+#include "utils.hpp"
+
+bool parse_codec_profile(const std::string& name, int quality, CodecProfile* profile) {
+    CodecProfile result;
+    if (name == "fast") {
+        result.dct_method = JDCT_IFAST;
+        result.fancy_upsampling = false;
+        result.quality = 90;
+    } else if (name == "compact") {
+        result.optimize_coding = true;
+        result.quality = 90;
+    } else if (name != "default") {
+        return false;
+    }
+    if (quality < 0 || quality > 100)
+        return false;
+    if (quality > 0)
+        result.quality = quality;
+    *profile = result;
+    return true;
+}
+
+void set_decode_profile(jpeg_decompress_struct* cinfo, const CodecProfile& profile) {
+    cinfo->dct_method = profile.dct_method;
+    cinfo->do_fancy_upsampling = profile.fancy_upsampling ? TRUE : FALSE;
+}
+
+void set_encode_profile(jpeg_compress_struct* cinfo, const CodecProfile& profile) {
+    jpeg_set_quality(cinfo, profile.quality, TRUE);
+    cinfo->dct_method = profile.dct_method;
+    cinfo->optimize_coding = profile.optimize_coding ? TRUE : FALSE;
+}
+
+namespace {
+
+void return_on_error(j_common_ptr cinfo) {
+    JPEGErrorManager* manager = reinterpret_cast<JPEGErrorManager*>(cinfo->err);
+    (*cinfo->err->output_message)(cinfo);
+    manager->failed = true;
+    longjmp(manager->escape, 1);
+}
+
+} // namespace
+
+struct jpeg_error_mgr* init_jpeg_error_manager(JPEGErrorManager* manager) {
+    manager->pub = jpeg_error_mgr{};
+    jpeg_std_error(&manager->pub);
+    manager->pub.error_exit = return_on_error;
+    manager->failed = false;
+    return &manager->pub;
+}
+
+/**
+ * Read buffer data and other metadata from JPEG file
+ * @param filepath
+ * @param out_color_space requested output color space, JCS_UNKNOWN for default
+ * @param profile decoder settings
+ * @return buffer NULL on error
+ */
+JPEGMeta read_from_jpeg(const char* filepath, J_COLOR_SPACE out_color_space, const CodecProfile& profile) {
+    JPEGReader reader;
+    if (open_jpeg_reader(&reader, filepath, out_color_space, profile))
+        return {NULL, 0, 0, 0};
+    int width = reader.width;
+    int height = reader.height;
+    int numChannels = reader.num_channels;
+    // Read RGB buffer data from JPEG
+    auto rgbImage = new unsigned char[width * height * numChannels];
+    for (int y = 0; y < height; y++)
+        if (read_jpeg_row(&reader, rgbImage + y * width * numChannels))
+            break;
+    J_COLOR_SPACE colorSpace = reader.color_space;
+    if (close_jpeg_reader(&reader)) {
+        delete[] rgbImage;
+        return {NULL, 0, 0, 0};
+    }
+    return {rgbImage, width, height, numChannels, colorSpace};
+}
+
+/**
+ * Write buffer data into JPEG file stored under the filepath
+ * @param data
+ * @param filepath
+ * @param profile encoder settings
+ * @return 0 on success, -1 on error (and no file is left behind)
+ */
+int write_to_jpeg(const JPEGMeta &data, const char* filepath, const CodecProfile& profile) {
+    JPEGWriter writer;
+    if (open_jpeg_writer(&writer, data.width, data.height, data.num_channels, data.color_space, filepath, profile))
+        return -1;
+    // Write buffer data to jpeg
+    for (int y = 0; y < data.height; y++)
+        if (write_jpeg_row(&writer, data.buffer + y * data.width * data.num_channels))
+            break;
+    if (close_jpeg_writer(&writer)) {
+        remove(filepath);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Open a JPEG file and start decompression
+ * @param reader
+ * @param filepath
+ * @param out_color_space requested output color space, JCS_UNKNOWN for default
+ * @param profile decoder settings
+ * @return 0 on success, -1 on error
+ */
+int open_jpeg_reader(JPEGReader* reader, const char* filepath, J_COLOR_SPACE out_color_space,
+                     const CodecProfile& profile) {
+    // Open file to read from
+    reader->file = fopen(filepath, "rb");
+    if (reader->file == NULL)
+        return -1;
+    // Initialize JPEG Decoder
+    reader->cinfo = jpeg_decompress_struct{};
+    reader->cinfo.err = init_jpeg_error_manager(&reader->jerr);
+    jpeg_create_decompress(&reader->cinfo);
+    if (setjmp(reader->jerr.escape)) {
+        jpeg_destroy_decompress(&reader->cinfo);
+        fclose(reader->file);
+        return -1;
+    }
+    jpeg_stdio_src(&reader->cinfo, reader->file);
+    // Read JPEG Header
+    jpeg_read_header(&reader->cinfo, TRUE);
+    if (out_color_space != JCS_UNKNOWN)
+        reader->cinfo.out_color_space = out_color_space;
+    set_decode_profile(&reader->cinfo, profile);
+    jpeg_start_decompress(&reader->cinfo);
+    reader->width = reader->cinfo.output_width;
+    reader->height = reader->cinfo.output_height;
+    reader->num_channels = reader->cinfo.output_components;
+    reader->color_space = reader->cinfo.out_color_space;
+    return 0;
+}
+
+/**
+ * Decode the next scanline into row (width * num_channels bytes)
+ * @return 0 on success, -1 on error
+ */
+int read_jpeg_row(JPEGReader* reader, unsigned char* row) {
+    if (reader->jerr.failed)
+        return -1;
+    if (setjmp(reader->jerr.escape))
+        return -1;
+    jpeg_read_scanlines(&reader->cinfo, &row, 1);
+    return 0;
+}
+
+int close_jpeg_reader(JPEGReader* reader) {
+    if (!reader->jerr.failed) {
+        if (setjmp(reader->jerr.escape) == 0)
+            jpeg_finish_decompress(&reader->cinfo);
+    }
+    jpeg_destroy_decompress(&reader->cinfo);
+    fclose(reader->file);   // Close jpeg file
+    return reader->jerr.failed ? -1 : 0;
+}
+
+/**
+ * Create a JPEG file and start compression (quality 100 unless profile
+ * says otherwise)
+ * @return 0 on success, -1 on error
+ */
+int open_jpeg_writer(JPEGWriter* writer, int width, int height, int num_channels,
+                     J_COLOR_SPACE color_space, const char* filepath, const CodecProfile& profile) {
+    // Open jpeg file to write to
+    writer->file = fopen(filepath, "wb");
+    if (writer->file == NULL)
+        return -1;
+    // Initialize JPEG Header
+    writer->cinfo = jpeg_compress_struct{};
+    writer->cinfo.err = init_jpeg_error_manager(&writer->jerr);
+    jpeg_create_compress(&writer->cinfo);
+    if (setjmp(writer->jerr.escape)) {
+        jpeg_destroy_compress(&writer->cinfo);
+        fclose(writer->file);
+        remove(filepath);
+        return -1;
+    }
+    jpeg_stdio_dest(&writer->cinfo, writer->file);
+    writer->cinfo.image_width = width;
+    writer->cinfo.image_height = height;
+    writer->cinfo.input_components = num_channels;
+    writer->cinfo.in_color_space = color_space;
+    jpeg_set_defaults(&writer->cinfo);
+    set_encode_profile(&writer->cinfo, profile);
+    jpeg_start_compress(&writer->cinfo, TRUE);
+    return 0;
+}
+
+/**
+ * Encode the next scanline from row (width * num_channels bytes)
+ * @return 0 on success, -1 on error
+ */
+int write_jpeg_row(JPEGWriter* writer, const unsigned char* row) {
+    if (writer->jerr.failed)
+        return -1;
+    if (setjmp(writer->jerr.escape))
+        return -1;
+    JSAMPROW rowPtr = const_cast<unsigned char*>(row);
+    jpeg_write_scanlines(&writer->cinfo, &rowPtr, 1);
+    return 0;
+}
+
+int close_jpeg_writer(JPEGWriter* writer) {
+    if (!writer->jerr.failed) {
+        if (setjmp(writer->jerr.escape) == 0)
+            jpeg_finish_compress(&writer->cinfo);
+    }
+    jpeg_destroy_compress(&writer->cinfo);
+    fclose(writer->file); // Close jpeg file
+    return writer->jerr.failed ? -1 : 0;
+}
@@ -1,33 +1,134 @@
-//
-// Created by Liu Yuxuan on 2023/9/15.
-// Email: yuxuanliu1@link.cuhk.edu.cm
-//
-// General utility function to read / write JPEG image with libjpeg
-//
-
-#ifndef CSC4005_PROJECT_1_UTILS_HPP
-#define CSC4005_PROJECT_1_UTILS_HPP
-
-#include <iostream>
-#include <cstdio>
-#include <cstdlib>
-
-#include <jpeglib.h>
-
-/**
- * Buffer data and other important metadata sufficient to build JPEG picture
- */
-struct JPEGMeta {
-    unsigned char* buffer;  // buffer data
-    int width;
-    int height;
-    int num_channels;
-    J_COLOR_SPACE color_space;
-};
-
-JPEGMeta read_from_jpeg(const char* filepath);
-
-int write_to_jpeg(const JPEGMeta &data, const char* filepath);
-
-
-#endif // CSC4005_PROJECT_1_UTILS_HPP
+//
+// Created by Liu Yuxuan on 2023/9/15.
+// Email: yuxuanliu1@link.cuhk.edu.cm
+//
+// General utility function to read / write JPEG image with libjpeg
+//
+
+#ifndef CSC4005_PROJECT_1_UTILS_HPP
+#define CSC4005_PROJECT_1_UTILS_HPP
+
+#include <iostream>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <jpeglib.h>
+
+/**
+ * Buffer data and other important metadata sufficient to build JPEG picture
+ */
+struct JPEGMeta {
+    unsigned char* buffer;  // buffer data
+    int width;
+    int height;
+    int num_channels;
+    J_COLOR_SPACE color_space;
+};
+
+/**
+ * libjpeg settings of the decoder and the encoder. The default profile is
+ * libjpeg's decoder defaults and an encoder at quality 100.
+ */
+struct CodecProfile {
+    J_DCT_METHOD dct_method = JDCT_ISLOW;   // JDCT_IFAST trades accuracy for a faster (I)DCT
+    bool fancy_upsampling = true;           // smooth chroma upsampling instead of pixel replication
+    bool optimize_coding = false;           // per-image Huffman tables: smaller files, one more pass
+    int quality = 100;                      // encoder quality, 1 to 100
+};
+
+/**
+ * Profile by name: "default", "fast" (integer fast DCT, no fancy
+ * upsampling, quality 90) or "compact" (optimized Huffman tables, quality
+ * 90). A quality of 1 to 100 overrides the profile's, 0 keeps it.
+ * @return false for an unknown name or an out of range quality
+ */
+bool parse_codec_profile(const std::string& name, int quality, CodecProfile* profile);
+
+/**
+ * Apply the decoder settings of profile, after jpeg_read_header
+ */
+void set_decode_profile(jpeg_decompress_struct* cinfo, const CodecProfile& profile);
+
+/**
+ * Apply the encoder settings of profile, after jpeg_set_defaults
+ */
+void set_encode_profile(jpeg_compress_struct* cinfo, const CodecProfile& profile);
+
+/**
+ * Read a JPEG file. out_color_space asks libjpeg for a given output color
+ * space; JCS_GRAYSCALE returns just the luma (Y) component, which skips
+ * chroma upsampling and color conversion. JCS_UNKNOWN keeps the default.
+ */
+JPEGMeta read_from_jpeg(const char* filepath, J_COLOR_SPACE out_color_space = JCS_UNKNOWN,
+                        const CodecProfile& profile = CodecProfile());
+
+int write_to_jpeg(const JPEGMeta &data, const char* filepath, const CodecProfile& profile = CodecProfile());
+
+/**
+ * libjpeg error handler that returns to the caller instead of calling
+ * exit(): every function below sets escape before calling into libjpeg,
+ * and a fatal error (corrupt or non-JPEG input, failed write) prints
+ * libjpeg's message, sets failed and longjmps back there
+ */
+struct JPEGErrorManager {
+    struct jpeg_error_mgr pub;  // first, libjpeg only sees this part
+    jmp_buf escape;
+    bool failed;
+};
+
+/**
+ * Reset manager and return its libjpeg part, for cinfo.err. The caller
+ * calls setjmp(manager->escape) before the libjpeg calls it guards.
+ */
+struct jpeg_error_mgr* init_jpeg_error_manager(JPEGErrorManager* manager);
+
+/**
+ * Scanline by scanline JPEG decoder, for pipelines that never hold the
+ * whole image. The libjpeg structs point into each other: keep the reader
+ * in place (no copies) between open and close. Once a call has failed the
+ * later rows are left untouched, and close still has to be called.
+ */
+struct JPEGReader {
+    FILE* file;
+    struct jpeg_decompress_struct cinfo;
+    JPEGErrorManager jerr;
+    int width;
+    int height;
+    int num_channels;
+    J_COLOR_SPACE color_space;
+};
+
+int open_jpeg_reader(JPEGReader* reader, const char* filepath, J_COLOR_SPACE out_color_space = JCS_UNKNOWN,
+                     const CodecProfile& profile = CodecProfile());
+
+int read_jpeg_row(JPEGReader* reader, unsigned char* row);
+
+/**
+ * @return 0 if the whole image decoded, -1 if any call failed
+ */
+int close_jpeg_reader(JPEGReader* reader);
+
+/**
+ * Scanline by scanline JPEG encoder, counterpart of JPEGReader
+ */
+struct JPEGWriter {
+    FILE* file;
+    struct jpeg_compress_struct cinfo;
+    JPEGErrorManager jerr;
+};
+
+int open_jpeg_writer(JPEGWriter* writer, int width, int height, int num_channels,
+                     J_COLOR_SPACE color_space, const char* filepath,
+                     const CodecProfile& profile = CodecProfile());
+
+int write_jpeg_row(JPEGWriter* writer, const unsigned char* row);
+
+/**
+ * @return 0 if the whole image was written, -1 if any call failed
+ */
+int close_jpeg_writer(JPEGWriter* writer);
+
+
+#endif // CSC4005_PROJECT_1_UTILS_HPP